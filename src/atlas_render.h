@@ -0,0 +1,1278 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <cstring>
+#include "atlas_ui_utilities.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////ATLAS UI RENDERING LAYER///////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////
+namespace Atlas {
+
+    /////////////////////////////////////////////////////////////////
+    ////////////SHADERS FOR THE QUAD BATCH//////////////////////////
+
+    const char* batchVertexShaderSource = R"(
+#version 330 core
+layout(location = 0) in vec2 aPos;
+layout(location = 1) in vec2 aTexCoord;
+layout(location = 2) in vec4 aColor;
+
+out vec2 TexCoord;
+out vec4 Color;
+
+uniform mat4 projection;
+
+void main()
+{
+    gl_Position = projection * vec4(aPos, 0.0, 1.0);
+    TexCoord = aTexCoord;
+    Color = aColor;
+}
+)";
+
+    // Expands one QuadInstance per instance into a rect, drawn as a 4 vertex strip
+    const char* instanceVertexShaderSource = R"(
+#version 330 core
+layout(location = 0) in vec4 aRect;  // x, y, width, height
+layout(location = 1) in vec4 aUV;    // u0, v0, u1, v1 with v0 at the top edge
+layout(location = 2) in vec4 aColor;
+
+out vec2 TexCoord;
+out vec4 Color;
+
+uniform mat4 projection;
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    gl_Position = projection * vec4(aRect.xy + corner * aRect.zw, 0.0, 1.0);
+    TexCoord = mix(aUV.xy, aUV.zw, corner);
+    Color = aColor;
+}
+)";
+
+    const char* batchFragmentShaderSource = R"(
+#version 330 core
+in vec2 TexCoord;
+in vec4 Color;
+out vec4 FragColor;
+
+uniform sampler2D texture1;
+
+void main()
+{
+    FragColor = texture(texture1, TexCoord) * Color;
+}
+)";
+
+    // Counters for the current frame, reset by renderUI()
+    struct RenderStats {
+        int drawCalls = 0;
+        int quads = 0;
+        int flushes = 0;
+        int commands = 0;         // Draw commands recorded, before grouping into draw calls
+        int streamStalls = 0;     // Times the vertex ring had to wait for the GPU to catch up
+        int instanceUploads = 0;  // Instance records written to the GPU, only what changed
+        int widgetsRendered = 0;  // Cached widgets that had to re-render this frame
+        int widgetsFromCache = 0; // Cached widgets drawn straight from their texture
+        int widgetsSkipped = 0;   // Widgets outside the damaged region
+        int damagedPixels = 0;    // Area of the region redrawn this frame, 0 when nothing changed
+    };
+
+    RenderStats renderStats;
+
+    // Size of the framebuffer we are drawing into, the height is used to flip scissor rects
+    int renderTargetWidth = 0;
+    int renderTargetHeight = 0;
+
+    // Window position of the framebuffer's top-left corner, (0, 0) for the window itself
+    int renderTargetX = 0, renderTargetY = 0;
+
+    /////////////////////////////////////////////////////////////////
+    ////////////QUAD BATCH//////////////////////////////////////////
+    // GL objects behind rect and text drawing. Components never draw quads directly,
+    // submitQuad() records them into the command list below. Vertices are
+    // streamed through the ring further down.
+    struct BatchVertex {
+        float x, y;
+        float u, v;
+        float r, g, b, a;
+    };
+
+    struct QuadBatch {
+        GLuint program = 0;
+        GLuint vao = 0, ebo = 0;
+        GLuint textVao = 0; // <pos, uv> vertices of submitText()
+        GLuint whiteTexture = 0; // 1x1 white texture used for untextured quads
+        GLint projectionLoc = -1;
+        GLint textureLoc = -1;
+        size_t indexCapacity = 0; // number of quads the index buffer can address
+    };
+
+    QuadBatch quadBatch;
+
+    /////////////////////////////////////////////////////////////////
+    ////////////STREAMING VERTEX RING///////////////////////////////
+    // Vertices rebuilt every frame go into one buffer split into a region per
+    // frame in flight. A region is fenced when its frame ends and only written
+    // again once the GPU has passed the fence, so uploads never wait on draws
+    // still reading the old data. With ARB_buffer_storage the buffer stays
+    // mapped for its whole life, otherwise it is orphaned on wrap around.
+    const int streamRegions = 3;
+    const size_t streamRegionSize = 1 << 20;
+    const size_t streamAlignment = sizeof(BatchVertex); // Offsets are whole vertices of either format
+
+    struct StreamRing {
+        GLuint buffer = 0;
+        size_t regionSize = 0;
+        int region = 0;         // Region the current frame writes into
+        size_t head = 0;        // Bytes used in it
+        bool persistent = false;
+        char* mapped = nullptr; // Whole buffer, persistent mode only
+        GLsync fences[streamRegions] = {};
+    };
+
+    StreamRing streamRing;
+
+    // Points the batch VAOs at the ring, after it is created or grown
+    void attachStreamAttributes() {
+        bindVertexArray(quadBatch.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, streamRing.buffer);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, x));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, u));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, r));
+        glEnableVertexAttribArray(2);
+
+        bindVertexArray(quadBatch.textVao);
+        glBindBuffer(GL_ARRAY_BUFFER, streamRing.buffer);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), 0);
+        glEnableVertexAttribArray(0);
+
+        bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void createStreamRing(size_t regionSize) {
+        StreamRing& ring = streamRing;
+        if (ring.buffer) {
+            // Draws already queued keep the old storage alive until they finish
+            for (auto& fence : ring.fences) {
+                if (fence) {
+                    glDeleteSync(fence);
+                    fence = nullptr;
+                }
+            }
+            if (ring.mapped) {
+                glBindBuffer(GL_ARRAY_BUFFER, ring.buffer);
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+                ring.mapped = nullptr;
+            }
+            glDeleteBuffers(1, &ring.buffer);
+        }
+        ring.regionSize = regionSize;
+        ring.region = 0;
+        ring.head = 0;
+
+        GLsizeiptr size = static_cast<GLsizeiptr>(regionSize * streamRegions);
+        glGenBuffers(1, &ring.buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, ring.buffer);
+        ring.persistent = GLEW_ARB_buffer_storage;
+        if (ring.persistent) {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+            ring.mapped = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+            if (!ring.mapped) {
+                std::cerr << "Failed to map the vertex ring, falling back to orphaning" << std::endl;
+                glDeleteBuffers(1, &ring.buffer); // Storage is immutable, start over
+                glGenBuffers(1, &ring.buffer);
+                glBindBuffer(GL_ARRAY_BUFFER, ring.buffer);
+                ring.persistent = false;
+            }
+        }
+        if (!ring.persistent) {
+            glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        attachStreamAttributes();
+    }
+
+    size_t alignStream(size_t offset) {
+        return (offset + streamAlignment - 1) / streamAlignment * streamAlignment;
+    }
+
+    // Blocks until the GPU is done with a region written three frames ago
+    void waitStreamFence(int region) {
+        GLsync& fence = streamRing.fences[region];
+        if (!fence) {
+            return;
+        }
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            renderStats.streamStalls++;
+            do {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            } while (result == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    // Fences what this frame wrote and moves on to the next region. renderUI()
+    // calls it once per frame, it also runs early when a region fills up.
+    void endStreamFrame() {
+        StreamRing& ring = streamRing;
+        if (!ring.buffer || ring.head == 0) {
+            return;
+        }
+        if (ring.persistent) {
+            ring.fences[ring.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        ring.region = (ring.region + 1) % streamRegions;
+        ring.head = 0;
+        if (!ring.persistent && ring.region == 0) {
+            // Fresh storage for the next lap, the driver retires the old one after its draws
+            glBindBuffer(GL_ARRAY_BUFFER, ring.buffer);
+            glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(ring.regionSize * streamRegions), nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+    }
+
+    // Makes sure bytes fit in the current region, by moving to the next one or growing the ring
+    void reserveStream(size_t bytes) {
+        StreamRing& ring = streamRing;
+        if (alignStream(ring.head) + bytes <= ring.regionSize) {
+            return;
+        }
+        if (bytes > ring.regionSize) {
+            size_t size = ring.regionSize * 2;
+            while (size < bytes) {
+                size *= 2;
+            }
+            createStreamRing(size);
+        }
+        else {
+            endStreamFrame();
+        }
+    }
+
+    // Copies vertices into the ring and returns their byte offset in streamRing.buffer
+    size_t streamVertices(const void* data, size_t bytes) {
+        StreamRing& ring = streamRing;
+        reserveStream(bytes);
+        size_t offset = alignStream(ring.head);
+        if (offset == 0) {
+            waitStreamFence(ring.region);
+        }
+        size_t position = ring.region * ring.regionSize + offset;
+        if (ring.persistent) {
+            std::memcpy(ring.mapped + position, data, bytes);
+        }
+        else {
+            // Nothing in flight reads this range, so the driver need not sync
+            glBindBuffer(GL_ARRAY_BUFFER, ring.buffer);
+            void* target = glMapBufferRange(GL_ARRAY_BUFFER, position, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (target) {
+                std::memcpy(target, data, bytes);
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+            }
+            else {
+                glBufferSubData(GL_ARRAY_BUFFER, position, bytes, data);
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        ring.head = offset + bytes;
+        return position;
+    }
+
+    void initQuadBatch(GLuint program) {
+        quadBatch.program = program;
+        quadBatch.projectionLoc = uniformLocation(program, "projection");
+        quadBatch.textureLoc = uniformLocation(program, "texture1");
+
+        glGenVertexArrays(1, &quadBatch.vao);
+        glGenVertexArrays(1, &quadBatch.textVao);
+        glGenBuffers(1, &quadBatch.ebo);
+
+        bindVertexArray(quadBatch.vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadBatch.ebo);
+        bindVertexArray(0);
+
+        createStreamRing(streamRegionSize);
+
+        // Untextured quads sample this so every quad goes through the same shader path
+        const unsigned char white[4] = { 255, 255, 255, 255 };
+        glGenTextures(1, &quadBatch.whiteTexture);
+        bindTexture(quadBatch.whiteTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+
+    // Grow the shared index buffer so it can address at least quadCount quads
+    void reserveBatchIndices(size_t quadCount) {
+        if (quadCount <= quadBatch.indexCapacity) {
+            return;
+        }
+        size_t capacity = std::max<size_t>(quadBatch.indexCapacity * 2, 1024);
+        while (capacity < quadCount) {
+            capacity *= 2;
+        }
+
+        std::vector<GLuint> indices(capacity * 6);
+        for (size_t i = 0; i < capacity; i++) {
+            GLuint base = static_cast<GLuint>(i * 4);
+            indices[i * 6 + 0] = base + 0;
+            indices[i * 6 + 1] = base + 1;
+            indices[i * 6 + 2] = base + 2;
+            indices[i * 6 + 3] = base + 2;
+            indices[i * 6 + 4] = base + 3;
+            indices[i * 6 + 5] = base + 0;
+        }
+
+        bindVertexArray(quadBatch.vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadBatch.ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        bindVertexArray(0);
+        quadBatch.indexCapacity = capacity;
+    }
+
+    // Window-space clip rect. Nested scissors clip to the intersection of the stack.
+    struct ScissorRect {
+        int x = 0, y = 0, width = 0, height = 0;
+    };
+
+    ScissorRect intersectScissor(const ScissorRect& a, const ScissorRect& b) {
+        ScissorRect rect;
+        rect.x = std::max(a.x, b.x);
+        rect.y = std::max(a.y, b.y);
+        rect.width = std::max(std::min(a.x + a.width, b.x + b.width) - rect.x, 0);
+        rect.height = std::max(std::min(a.y + a.height, b.y + b.height) - rect.y, 0);
+        return rect;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    ////////////INSTANCE BUFFER/////////////////////////////////////
+    // Quads of widgets that did not change stay on the GPU between frames, one
+    // record per quad in a single buffer. Every retained widget owns a slice
+    // of it and only slices that changed are written again.
+    struct QuadInstance {
+        float x, y, w, h;
+        float u0, v0, u1, v1;
+        float r, g, b, a;
+    };
+
+    struct InstanceSlice {
+        size_t first = 0;
+        size_t count = 0;    // records in use
+        size_t capacity = 0; // records reserved
+    };
+
+    struct InstanceBuffer {
+        GLuint program = 0;
+        GLuint vao = 0, buffer = 0;
+        GLint projectionLoc = -1;
+        GLint textureLoc = -1;
+        std::vector<QuadInstance> records;  // CPU copy of the whole buffer
+        std::vector<InstanceSlice> freeSlices;
+        std::vector<std::pair<size_t, size_t>> dirty; // <first, count> ranges to write before drawing
+        size_t gpuCapacity = 0;             // records the GL buffer can hold
+    };
+
+    InstanceBuffer instanceBuffer;
+
+    // Points the instance attributes at record first. Only needed without ARB_base_instance.
+    void pointInstanceAttributes(size_t first) {
+        const char* base = reinterpret_cast<const char*>(first * sizeof(QuadInstance));
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), base + offsetof(QuadInstance, x));
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), base + offsetof(QuadInstance, u0));
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), base + offsetof(QuadInstance, r));
+    }
+
+    void initInstanceBuffer(GLuint program) {
+        instanceBuffer.program = program;
+        instanceBuffer.projectionLoc = uniformLocation(program, "projection");
+        instanceBuffer.textureLoc = uniformLocation(program, "texture1");
+
+        glGenVertexArrays(1, &instanceBuffer.vao);
+        glGenBuffers(1, &instanceBuffer.buffer);
+        bindVertexArray(instanceBuffer.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.buffer);
+        for (GLuint attribute = 0; attribute < 3; attribute++) {
+            glEnableVertexAttribArray(attribute);
+            glVertexAttribDivisor(attribute, 1);
+        }
+        pointInstanceAttributes(0);
+        bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void markInstancesDirty(size_t first, size_t count) {
+        if (count > 0) {
+            instanceBuffer.dirty.push_back({ first, count });
+        }
+    }
+
+    // Reserves room for count records, slices come in powers of two so they can grow in place for a while
+    InstanceSlice allocateInstances(size_t count) {
+        InstanceBuffer& buffer = instanceBuffer;
+        size_t capacity = 16;
+        while (capacity < count) {
+            capacity *= 2;
+        }
+        for (size_t i = 0; i < buffer.freeSlices.size(); i++) {
+            InstanceSlice& free = buffer.freeSlices[i];
+            if (free.capacity >= capacity) {
+                InstanceSlice slice{ free.first, 0, capacity };
+                free.first += capacity;
+                free.capacity -= capacity;
+                if (free.capacity == 0) {
+                    buffer.freeSlices.erase(buffer.freeSlices.begin() + i);
+                }
+                return slice;
+            }
+        }
+        InstanceSlice slice{ buffer.records.size(), 0, capacity };
+        buffer.records.resize(buffer.records.size() + capacity);
+        return slice;
+    }
+
+    void releaseInstances(InstanceSlice& slice) {
+        if (slice.capacity > 0) {
+            instanceBuffer.freeSlices.push_back({ slice.first, 0, slice.capacity });
+        }
+        slice = InstanceSlice();
+    }
+
+    // Writes the ranges that changed since the last call, merging ranges that touch
+    void uploadInstances() {
+        InstanceBuffer& buffer = instanceBuffer;
+        if (buffer.dirty.empty()) {
+            return;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.buffer);
+        if (buffer.records.size() > buffer.gpuCapacity) {
+            buffer.gpuCapacity = std::max<size_t>(buffer.records.capacity(), 1024);
+            glBufferData(GL_ARRAY_BUFFER, buffer.gpuCapacity * sizeof(QuadInstance), nullptr, GL_DYNAMIC_DRAW);
+            buffer.dirty.assign(1, { 0, buffer.records.size() }); // New storage starts out empty
+        }
+
+        std::sort(buffer.dirty.begin(), buffer.dirty.end());
+        size_t first = buffer.dirty[0].first;
+        size_t end = first;
+        for (size_t i = 0; i <= buffer.dirty.size(); i++) {
+            if (i < buffer.dirty.size() && buffer.dirty[i].first <= end) {
+                end = std::max(end, buffer.dirty[i].first + buffer.dirty[i].second);
+                continue;
+            }
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(QuadInstance), (end - first) * sizeof(QuadInstance), buffer.records.data() + first);
+            renderStats.instanceUploads += static_cast<int>(end - first);
+            if (i < buffer.dirty.size()) {
+                first = buffer.dirty[i].first;
+                end = first + buffer.dirty[i].second;
+            }
+        }
+        buffer.dirty.clear();
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Draws count records from first, the instance VAO must be bound
+    void drawInstances(size_t first, size_t count) {
+        if (GLEW_ARB_base_instance) {
+            glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(count), static_cast<GLuint>(first));
+        }
+        else {
+            glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.buffer);
+            pointInstanceAttributes(first);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(count));
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////
+    ////////////COMMAND LIST////////////////////////////////////////
+    // Components record what to draw instead of drawing it. flushBatch() groups
+    // commands that share a program, texture and clip and draws each group with
+    // one call. A command only moves ahead of commands it does not overlap, so
+    // blending order is kept wherever it can be seen.
+    enum DrawCommandType {
+        DRAW_QUADS,     // quads in DrawList::quadVertices, drawn with the batch shader
+        DRAW_TEXT,      // glyph vertices in DrawList::textVertices
+        DRAW_TEXT_MESH, // glyph vertices that live in a TextMesh's own buffer
+        DRAW_INSTANCES  // records in instanceBuffer, from a retained list
+    };
+
+    // Window-space area a command touches
+    struct DrawRect {
+        float left = 0.0f, top = 0.0f, right = 0.0f, bottom = 0.0f;
+
+        bool Overlaps(const DrawRect& other) const {
+            return left < other.right && other.left < right && top < other.bottom && other.top < bottom;
+        }
+
+        void Extend(const DrawRect& other) {
+            left = std::min(left, other.left);
+            top = std::min(top, other.top);
+            right = std::max(right, other.right);
+            bottom = std::max(bottom, other.bottom);
+        }
+    };
+
+    // Uniforms of the text shader, text commands only share a draw when these match
+    struct TextStyle {
+        glm::vec3 color = glm::vec3(0.0f);
+        int sdf = 0;
+        float outlineWidth = 0.0f;
+        glm::vec3 outlineColor = glm::vec3(0.0f);
+        glm::vec2 shadowOffset = glm::vec2(0.0f);
+        glm::vec4 shadowColor = glm::vec4(0.0f);
+        glm::vec2 translate = glm::vec2(0.0f); // Moves retained text without rebuilding it
+
+        bool operator==(const TextStyle& other) const {
+            return color == other.color && sdf == other.sdf && outlineWidth == other.outlineWidth &&
+                outlineColor == other.outlineColor && shadowOffset == other.shadowOffset && shadowColor == other.shadowColor &&
+                translate == other.translate;
+        }
+    };
+
+    struct DrawCommand {
+        DrawCommandType type = DRAW_QUADS;
+        int layer = 0;
+        GLuint program = 0;
+        GLuint texture = 0;
+        GLuint vao = 0;    // DRAW_TEXT_MESH only
+        const glm::vec4* vertices = nullptr; // DRAW_TEXT_MESH only, the mesh's CPU copy for the software rasterizer
+        int clip = -1;     // index into DrawList::clips, -1 when unclipped
+        int style = -1;    // index into DrawList::styles, -1 for quads
+        size_t first = 0;  // first quad, or first vertex for text
+        size_t count = 0;  // quads, or vertices for text
+        DrawRect bounds;   // already clipped
+        int next = -1;     // next command of the same group while submitting
+    };
+
+    struct DrawList {
+        struct Group {
+            int first, last;  // chain of commands through DrawCommand::next
+            DrawRect bounds;
+            size_t drawFirst, drawCount;
+        };
+
+        std::vector<DrawCommand> commands;
+        std::vector<BatchVertex> quadVertices;
+        std::vector<glm::vec4> textVertices;
+        std::vector<ScissorRect> clips;
+        std::vector<TextStyle> styles;
+        std::vector<ScissorRect> scissorStack;
+        int layer = 0;
+        int clip = -1;
+        bool clipValid = false; // false once scissorStack changes
+
+        // Submission scratch, kept between flushes to avoid allocations
+        std::vector<int> order;
+        std::vector<Group> groups;
+        std::vector<BatchVertex> quadUpload;
+        std::vector<glm::vec4> textUpload;
+    };
+
+    DrawList drawList; // Submitted by flushBatch() on the GL thread
+
+    // List the calling thread records into, drawList unless a worker set its own
+    thread_local DrawList* recordingList = nullptr;
+
+    DrawList& activeDrawList() {
+        return recordingList ? *recordingList : drawList;
+    }
+
+    // Drops recorded commands, the scissor stack and layer are kept
+    void clearDrawList(DrawList& list) {
+        list.commands.clear();
+        list.quadVertices.clear();
+        list.textVertices.clear();
+        list.clips.clear();
+        list.styles.clear();
+        list.clipValid = false;
+    }
+
+    // How many groups back a command looks for one it can join
+    const int drawMergeWindow = 32;
+
+    // Higher layers draw over lower ones no matter when they were recorded, 0 by default
+    void setDrawLayer(int layer) {
+        activeDrawList().layer = layer;
+    }
+
+    int getDrawLayer() {
+        return activeDrawList().layer;
+    }
+
+    // Clip of the next command, the top of scissorStack at the time it is recorded
+    int currentClip(DrawList& list) {
+        if (!list.clipValid) {
+            list.clip = -1;
+            if (!list.scissorStack.empty()) {
+                list.clips.push_back(list.scissorStack.back());
+                list.clip = static_cast<int>(list.clips.size()) - 1;
+            }
+            list.clipValid = true;
+        }
+        return list.clip;
+    }
+
+    // Returns false when the clip leaves nothing to draw
+    bool clipBounds(const DrawList& list, DrawRect& bounds, int clip) {
+        if (clip >= 0) {
+            const ScissorRect& rect = list.clips[clip];
+            bounds.left = std::max(bounds.left, static_cast<float>(rect.x));
+            bounds.top = std::max(bounds.top, static_cast<float>(rect.y));
+            bounds.right = std::min(bounds.right, static_cast<float>(rect.x + rect.width));
+            bounds.bottom = std::min(bounds.bottom, static_cast<float>(rect.y + rect.height));
+        }
+        return bounds.left < bounds.right && bounds.top < bounds.bottom;
+    }
+
+    DrawRect vertexBounds(const glm::vec4* vertices, size_t count) {
+        DrawRect bounds = { vertices[0].x, vertices[0].y, vertices[0].x, vertices[0].y };
+        for (size_t i = 1; i < count; i++) {
+            bounds.left = std::min(bounds.left, vertices[i].x);
+            bounds.top = std::min(bounds.top, vertices[i].y);
+            bounds.right = std::max(bounds.right, vertices[i].x);
+            bounds.bottom = std::max(bounds.bottom, vertices[i].y);
+        }
+        return bounds;
+    }
+
+    bool canShareDraw(const DrawCommand& a, const DrawCommand& b) {
+        if (a.type != b.type || a.type == DRAW_TEXT_MESH || a.program != b.program || a.texture != b.texture || a.clip != b.clip) {
+            return false;
+        }
+        return a.style == b.style || (a.style >= 0 && b.style >= 0 && drawList.styles[a.style] == drawList.styles[b.style]);
+    }
+
+    int recordStyle(DrawList& list, const TextStyle& style) {
+        if (list.styles.empty() || !(list.styles.back() == style)) {
+            list.styles.push_back(style);
+        }
+        return static_cast<int>(list.styles.size()) - 1;
+    }
+
+    // Queue a rect. uv is (u0, v0, u1, v1) with v0 at the top edge of the rect.
+    void submitQuad(float x, float y, float w, float h, const glm::vec4& color, GLuint texture = 0, const glm::vec4& uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)) {
+        if (texture == 0) {
+            texture = quadBatch.whiteTexture;
+        }
+
+        DrawList& list = activeDrawList();
+        DrawCommand command;
+        command.type = DRAW_QUADS;
+        command.layer = list.layer;
+        command.program = quadBatch.program;
+        command.texture = texture;
+        command.clip = currentClip(list);
+        command.bounds = { std::min(x, x + w), std::min(y, y + h), std::max(x, x + w), std::max(y, y + h) };
+        if (!clipBounds(list, command.bounds, command.clip)) {
+            return; // Scissored away entirely
+        }
+        command.first = list.quadVertices.size() / 4;
+        command.count = 1;
+
+        list.quadVertices.push_back({ x,     y + h, uv.x, uv.w, color.r, color.g, color.b, color.a });
+        list.quadVertices.push_back({ x + w, y + h, uv.z, uv.w, color.r, color.g, color.b, color.a });
+        list.quadVertices.push_back({ x + w, y,     uv.z, uv.y, color.r, color.g, color.b, color.a });
+        list.quadVertices.push_back({ x,     y,     uv.x, uv.y, color.r, color.g, color.b, color.a });
+        list.commands.push_back(command);
+    }
+
+    // Queue glyph quads (six <pos, uv> vertices each) that all sample texture
+    void submitText(GLuint program, GLuint texture, const TextStyle& style, const glm::vec4* vertices, size_t count) {
+        if (count == 0) {
+            return;
+        }
+
+        DrawList& list = activeDrawList();
+        DrawCommand command;
+        command.type = DRAW_TEXT;
+        command.layer = list.layer;
+        command.program = program;
+        command.texture = texture;
+        command.clip = currentClip(list);
+        command.bounds = vertexBounds(vertices, count);
+        if (!clipBounds(list, command.bounds, command.clip)) {
+            return;
+        }
+        command.style = recordStyle(list, style);
+        command.first = list.textVertices.size();
+        command.count = count;
+
+        list.textVertices.insert(list.textVertices.end(), vertices, vertices + count);
+        list.commands.push_back(command);
+    }
+
+    // Queue a range of a retained vertex buffer, vao must stay alive until the next flush.
+    // vertices is the same range on the CPU when the mesh keeps one, null otherwise.
+    void submitTextMesh(GLuint program, GLuint vao, GLuint texture, const TextStyle& style, size_t first, size_t count, const DrawRect& bounds, const glm::vec4* vertices = nullptr) {
+        DrawList& list = activeDrawList();
+        DrawCommand command;
+        command.type = DRAW_TEXT_MESH;
+        command.layer = list.layer;
+        command.program = program;
+        command.texture = texture;
+        command.vao = vao;
+        command.vertices = vertices;
+        command.clip = currentClip(list);
+        command.bounds = bounds;
+        if (count == 0 || !clipBounds(list, command.bounds, command.clip)) {
+            return;
+        }
+        command.style = recordStyle(list, style);
+        command.first = first;
+        command.count = count;
+        list.commands.push_back(command);
+    }
+
+    void applyClip(const ScissorRect* rect) {
+        if (!rect) {
+            setScissorEnabled(false);
+            return;
+        }
+        setScissorEnabled(true);
+        setScissorBox(rect->x - renderTargetX, renderTargetHeight - (rect->y - renderTargetY + rect->height), rect->width, rect->height);
+    }
+
+    // Sets the GL scissor to the top of scissorStack, for raw GL such as glClear
+    void applyScissor() {
+        applyClip(drawList.scissorStack.empty() ? nullptr : &drawList.scissorStack.back());
+    }
+
+    void setTextUniforms(GLuint program, const TextStyle& style) {
+        glUniform3f(uniformLocation(program, "textColor"), style.color.x, style.color.y, style.color.z);
+        glUniform1i(uniformLocation(program, "sdf"), style.sdf);
+        glUniform1f(uniformLocation(program, "outlineWidth"), style.outlineWidth);
+        glUniform3f(uniformLocation(program, "outlineColor"), style.outlineColor.x, style.outlineColor.y, style.outlineColor.z);
+        glUniform2f(uniformLocation(program, "shadowOffset"), style.shadowOffset.x, style.shadowOffset.y);
+        glUniform4f(uniformLocation(program, "shadowColor"), style.shadowColor.x, style.shadowColor.y, style.shadowColor.z, style.shadowColor.w);
+        glUniform2f(uniformLocation(program, "translate"), style.translate.x, style.translate.y);
+    }
+
+    // Sort and draw everything recorded so far. Called before anything that
+    // changes what recorded commands would draw into: render targets, blend
+    // mode, glyph atlas eviction.
+    void flushBatch() {
+        if (recordingList) {
+            return; // Workers only record, the GL thread submits
+        }
+        std::vector<DrawCommand>& commands = drawList.commands;
+        if (commands.empty()) {
+            clearDrawList(drawList);
+            return;
+        }
+        renderStats.commands += static_cast<int>(commands.size());
+        renderStats.quads += static_cast<int>(drawList.quadVertices.size() / 4);
+        uploadInstances();
+
+        // Layers first, recording order within a layer
+        std::vector<int>& order = drawList.order;
+        order.resize(commands.size());
+        bool layered = false;
+        for (size_t i = 0; i < commands.size(); i++) {
+            order[i] = static_cast<int>(i);
+            layered |= commands[i].layer != commands[0].layer;
+            if (commands[i].type == DRAW_INSTANCES) {
+                renderStats.quads += static_cast<int>(commands[i].count);
+            }
+        }
+        if (layered) {
+            std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return commands[a].layer < commands[b].layer; });
+        }
+
+        // Each command joins the newest group it can share a draw with, as long as
+        // no group in between overlaps it. Otherwise it starts a new group.
+        std::vector<DrawList::Group>& groups = drawList.groups;
+        groups.clear();
+        for (int index : order) {
+            DrawCommand& command = commands[index];
+            command.next = -1;
+            int target = -1;
+            int stop = std::max(0, static_cast<int>(groups.size()) - drawMergeWindow);
+            for (int g = static_cast<int>(groups.size()) - 1; g >= stop; g--) {
+                const DrawCommand& head = commands[groups[g].first];
+                if (head.layer != command.layer) {
+                    break;
+                }
+                if (canShareDraw(head, command)) {
+                    target = g;
+                    break;
+                }
+                if (groups[g].bounds.Overlaps(command.bounds)) {
+                    break;
+                }
+            }
+            if (target < 0) {
+                groups.push_back({ index, index, command.bounds, 0, 0 });
+            }
+            else {
+                commands[groups[target].last].next = index;
+                groups[target].last = index;
+                groups[target].bounds.Extend(command.bounds);
+            }
+        }
+
+        // Lay the vertex data out group by group so every group is one range
+        drawList.quadUpload.clear();
+        drawList.textUpload.clear();
+        for (auto& group : groups) {
+            const DrawCommand& head = commands[group.first];
+            if (head.type == DRAW_TEXT_MESH) {
+                group.drawFirst = head.first;
+                group.drawCount = head.count;
+                continue;
+            }
+            if (head.type == DRAW_INSTANCES) {
+                continue; // Already on the GPU
+            }
+            group.drawFirst = head.type == DRAW_QUADS ? drawList.quadUpload.size() / 4 : drawList.textUpload.size();
+            for (int i = group.first; i >= 0; i = commands[i].next) {
+                const DrawCommand& command = commands[i];
+                if (command.type == DRAW_QUADS) {
+                    auto begin = drawList.quadVertices.begin() + command.first * 4;
+                    drawList.quadUpload.insert(drawList.quadUpload.end(), begin, begin + command.count * 4);
+                }
+                else {
+                    auto begin = drawList.textVertices.begin() + command.first;
+                    drawList.textUpload.insert(drawList.textUpload.end(), begin, begin + command.count);
+                }
+            }
+            group.drawCount = (head.type == DRAW_QUADS ? drawList.quadUpload.size() / 4 : drawList.textUpload.size()) - group.drawFirst;
+        }
+
+        // Both uploads share one region, reserve them together so growing the ring cannot drop the first
+        size_t quadBytes = drawList.quadUpload.size() * sizeof(BatchVertex);
+        size_t textBytes = drawList.textUpload.size() * sizeof(glm::vec4);
+        reserveStream(quadBytes + streamAlignment + textBytes);
+        GLint quadBase = 0, textBase = 0; // first vertex of each upload in the ring
+        if (quadBytes) {
+            reserveBatchIndices(drawList.quadUpload.size() / 4);
+            quadBase = static_cast<GLint>(streamVertices(drawList.quadUpload.data(), quadBytes) / sizeof(BatchVertex));
+        }
+        if (textBytes) {
+            textBase = static_cast<GLint>(streamVertices(drawList.textUpload.data(), textBytes) / sizeof(glm::vec4));
+        }
+
+        GLuint projectedQuads = 0, projectedText = 0, projectedInstances = 0; // programs whose projection is set for this flush
+        int textStyle = -1;
+        for (const auto& group : groups) {
+            const DrawCommand& head = commands[group.first];
+            applyClip(head.clip >= 0 ? &drawList.clips[head.clip] : nullptr);
+            useProgram(head.program);
+            if (head.type == DRAW_QUADS) {
+                if (projectedQuads != head.program) {
+                    glUniformMatrix4fv(quadBatch.projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+                    glUniform1i(quadBatch.textureLoc, 0);
+                    projectedQuads = head.program;
+                }
+                bindVertexArray(quadBatch.vao);
+                bindTexture(head.texture);
+                glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(group.drawCount * 6), GL_UNSIGNED_INT, (void*)(group.drawFirst * 6 * sizeof(GLuint)), quadBase);
+                renderStats.drawCalls++;
+            }
+            else if (head.type == DRAW_INSTANCES) {
+                if (projectedInstances != head.program) {
+                    glUniformMatrix4fv(instanceBuffer.projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+                    glUniform1i(instanceBuffer.textureLoc, 0);
+                    projectedInstances = head.program;
+                }
+                bindVertexArray(instanceBuffer.vao);
+                bindTexture(head.texture);
+                // One call per run of neighbouring records, slices of different widgets are apart
+                for (int i = group.first; i >= 0;) {
+                    size_t first = commands[i].first;
+                    size_t count = commands[i].count;
+                    for (i = commands[i].next; i >= 0 && commands[i].first == first + count; i = commands[i].next) {
+                        count += commands[i].count;
+                    }
+                    drawInstances(first, count);
+                    renderStats.drawCalls++;
+                }
+            }
+            else {
+                if (projectedText != head.program) {
+                    glUniformMatrix4fv(uniformLocation(head.program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+                    glUniform1i(uniformLocation(head.program, "text"), 0);
+                    projectedText = head.program;
+                    textStyle = -1;
+                }
+                if (textStyle < 0 || !(drawList.styles[textStyle] == drawList.styles[head.style])) {
+                    setTextUniforms(head.program, drawList.styles[head.style]);
+                    textStyle = head.style;
+                }
+                bool streamed = head.type == DRAW_TEXT;
+                bindVertexArray(streamed ? quadBatch.textVao : head.vao);
+                bindTexture(head.texture);
+                glDrawArrays(GL_TRIANGLES, static_cast<GLint>(group.drawFirst) + (streamed ? textBase : 0), static_cast<GLsizei>(group.drawCount));
+                renderStats.drawCalls++;
+            }
+        }
+
+        clearDrawList(drawList);
+        renderStats.flushes++;
+    }
+
+    // Clip everything recorded until endScissor() to a rect in window coordinates
+    void beginScissor(int x, int y, int width, int height) {
+        DrawList& list = activeDrawList();
+        ScissorRect rect{ x, y, width, height };
+        if (!list.scissorStack.empty()) {
+            rect = intersectScissor(rect, list.scissorStack.back());
+        }
+        list.scissorStack.push_back(rect);
+        list.clipValid = false;
+    }
+
+    void endScissor() {
+        DrawList& list = activeDrawList();
+        if (!list.scissorStack.empty()) {
+            list.scissorStack.pop_back();
+        }
+        list.clipValid = false;
+    }
+
+    // Moves another list's commands onto the end of drawList, in order
+    void appendDrawList(DrawList& list) {
+        size_t quadBase = drawList.quadVertices.size() / 4;
+        size_t textBase = drawList.textVertices.size();
+        int clipBase = static_cast<int>(drawList.clips.size());
+        int styleBase = static_cast<int>(drawList.styles.size());
+        for (DrawCommand command : list.commands) {
+            if (command.type == DRAW_QUADS) {
+                command.first += quadBase;
+            }
+            else if (command.type == DRAW_TEXT) {
+                command.first += textBase;
+            }
+            if (command.clip >= 0) {
+                command.clip += clipBase;
+            }
+            if (command.style >= 0) {
+                command.style += styleBase;
+            }
+            drawList.commands.push_back(command);
+        }
+        drawList.quadVertices.insert(drawList.quadVertices.end(), list.quadVertices.begin(), list.quadVertices.end());
+        drawList.textVertices.insert(drawList.textVertices.end(), list.textVertices.begin(), list.textVertices.end());
+        drawList.clips.insert(drawList.clips.end(), list.clips.begin(), list.clips.end());
+        drawList.styles.insert(drawList.styles.end(), list.styles.begin(), list.styles.end());
+        clearDrawList(list);
+    }
+
+    /////////////////////////////////////////////////////////////////
+    ////////////RETAINED DRAW LISTS/////////////////////////////////
+    // A recorded list kept across frames. Its quads move into an instance
+    // slice, so drawing it again only appends commands, and moving it only
+    // rewrites that slice. Text moves through the style's translate.
+    struct RetainedList {
+        DrawList list;
+        InstanceSlice slice;
+        int x = 0, y = 0;              // origin the list was recorded at
+        uint32_t glyphGeneration = 0;  // glyphAtlasGeneration when recorded
+        bool valid = false;
+    };
+
+    // Bumped on every glyph page eviction, retained text may point at reused atlas space
+    uint32_t glyphAtlasGeneration = 0;
+
+    // Takes over a freshly recorded list (recorded without an outer scissor) and
+    // writes its quads to the instance buffer
+    void retainDrawList(RetainedList& retained, DrawList& recorded, int x, int y) {
+        std::swap(retained.list, recorded);
+        clearDrawList(recorded);
+        DrawList& list = retained.list;
+
+        size_t quads = list.quadVertices.size() / 4;
+        if (quads > retained.slice.capacity) {
+            releaseInstances(retained.slice);
+            retained.slice = allocateInstances(quads);
+        }
+        retained.slice.count = quads;
+        for (size_t i = 0; i < quads; i++) {
+            // submitQuad's corners: 0 is (x, y + h), 1 is (x + w, y + h), 3 is (x, y)
+            const BatchVertex* v = &list.quadVertices[i * 4];
+            instanceBuffer.records[retained.slice.first + i] = {
+                v[3].x, v[3].y, v[1].x - v[3].x, v[1].y - v[3].y,
+                v[3].u, v[3].v, v[1].u, v[1].v,
+                v[0].r, v[0].g, v[0].b, v[0].a };
+        }
+        markInstancesDirty(retained.slice.first, quads);
+
+        for (auto& command : list.commands) {
+            if (command.type == DRAW_QUADS) {
+                command.type = DRAW_INSTANCES;
+                command.program = instanceBuffer.program;
+                command.first += retained.slice.first;
+            }
+        }
+        list.quadVertices.clear();
+        list.scissorStack.clear();
+        list.layer = 0;
+
+        retained.x = x;
+        retained.y = y;
+        retained.glyphGeneration = glyphAtlasGeneration;
+        retained.valid = true;
+    }
+
+    // Shifts a retained list to a new origin, touching only its own slice
+    void moveRetainedList(RetainedList& retained, int x, int y) {
+        int dx = x - retained.x;
+        int dy = y - retained.y;
+        if (dx == 0 && dy == 0) {
+            return;
+        }
+        for (size_t i = 0; i < retained.slice.count; i++) {
+            QuadInstance& record = instanceBuffer.records[retained.slice.first + i];
+            record.x += dx;
+            record.y += dy;
+        }
+        markInstancesDirty(retained.slice.first, retained.slice.count);
+
+        DrawList& list = retained.list;
+        for (auto& command : list.commands) {
+            command.bounds.left += dx;
+            command.bounds.right += dx;
+            command.bounds.top += dy;
+            command.bounds.bottom += dy;
+        }
+        for (auto& clip : list.clips) {
+            clip.x += dx;
+            clip.y += dy;
+        }
+        for (auto& style : list.styles) {
+            style.translate += glm::vec2(static_cast<float>(dx), static_cast<float>(dy));
+        }
+        retained.x = x;
+        retained.y = y;
+    }
+
+    void releaseRetainedList(RetainedList& retained) {
+        releaseInstances(retained.slice);
+        clearDrawList(retained.list);
+        retained.valid = false;
+    }
+
+    // Copies a retained list onto drawList, clipped to the scissor open there
+    void appendRetainedList(const RetainedList& retained) {
+        const DrawList& list = retained.list;
+        int outerClip = currentClip(drawList);
+        int clipBase = static_cast<int>(drawList.clips.size());
+        for (const auto& clip : list.clips) {
+            drawList.clips.push_back(outerClip >= 0 ? intersectScissor(drawList.clips[outerClip], clip) : clip);
+        }
+        size_t textBase = drawList.textVertices.size();
+        int styleBase = static_cast<int>(drawList.styles.size());
+        for (DrawCommand command : list.commands) {
+            command.clip = command.clip >= 0 ? command.clip + clipBase : outerClip;
+            if (!clipBounds(drawList, command.bounds, command.clip)) {
+                continue;
+            }
+            if (command.type == DRAW_TEXT) {
+                command.first += textBase;
+            }
+            if (command.style >= 0) {
+                command.style += styleBase;
+            }
+            command.layer += drawList.layer;
+            drawList.commands.push_back(command);
+        }
+        drawList.textVertices.insert(drawList.textVertices.end(), list.textVertices.begin(), list.textVertices.end());
+        drawList.styles.insert(drawList.styles.end(), list.styles.begin(), list.styles.end());
+    }
+
+    /////////////////////////////////////////////////////////////////
+    ////////////RECORDING ON WORKERS////////////////////////////////
+    // While widgets record on worker threads nothing may touch GL. Uploads
+    // found during recording are queued with deferGL() and run on the GL
+    // thread before submission. Work that cannot wait calls refuseRecording()
+    // and the widget is recorded again on the GL thread.
+    std::atomic<bool> recordingOffThread{ false };
+    thread_local bool recordingRefused = false;
+
+    // Glyph pages are not evicted while set, text recorded earlier in the frame may still use them
+    bool holdGlyphEviction = false;
+
+    std::mutex deferredGLMutex;
+    std::vector<std::function<void()>> deferredGL;
+
+    // Runs work now on the GL thread, or after the current parallel recording
+    void deferGL(std::function<void()> work) {
+        if (!recordingOffThread) {
+            work();
+            return;
+        }
+        std::lock_guard<std::mutex> lock(deferredGLMutex);
+        deferredGL.push_back(std::move(work));
+    }
+
+    void runDeferredGL() {
+        std::vector<std::function<void()>> work;
+        {
+            std::lock_guard<std::mutex> lock(deferredGLMutex);
+            work.swap(deferredGL);
+        }
+        for (auto& job : work) {
+            job();
+        }
+    }
+
+    void refuseRecording() {
+        recordingRefused = true;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    ////////////RENDER TARGETS//////////////////////////////////////
+    // Offscreen color buffers that UI can be drawn into once and reused as a
+    // texture. Contents are premultiplied alpha, see compositeRenderTarget().
+    struct RenderTarget {
+        GLuint fbo = 0;
+        GLuint texture = 0;
+        int width = 0, height = 0;
+    };
+
+    // Everything beginRenderTarget() changes, restored by endRenderTarget()
+    struct SavedRenderState {
+        GLuint framebuffer;
+        GLint viewport[4];
+        GLint blend[4];
+        glm::mat4 projection;
+        int targetX, targetY, targetWidth, targetHeight;
+        std::vector<ScissorRect> scissors;
+    };
+
+    std::vector<SavedRenderState> renderStateStack;
+
+    // Allocates or resizes the target, returns true when its contents were lost
+    bool resizeRenderTarget(RenderTarget& target, int width, int height) {
+        width = std::max(width, 1);
+        height = std::max(height, 1);
+        if (target.fbo && target.width == width && target.height == height) {
+            return false;
+        }
+
+        if (!target.fbo) {
+            glGenFramebuffers(1, &target.fbo);
+            glGenTextures(1, &target.texture);
+        }
+        bindTexture(target.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        GLuint previous = currentFramebuffer();
+        bindFramebuffer(target.fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Render target framebuffer is incomplete" << std::endl;
+        }
+        bindFramebuffer(previous);
+
+        target.width = width;
+        target.height = height;
+        return true;
+    }
+
+    void destroyRenderTarget(RenderTarget& target) {
+        if (target.fbo) {
+            forgetFramebuffer(target.fbo);
+            glDeleteFramebuffers(1, &target.fbo);
+            forgetTexture(target.texture);
+            glDeleteTextures(1, &target.texture);
+        }
+        target = RenderTarget();
+    }
+
+    // Redirect drawing into target until endRenderTarget(). (x, y) is the window
+    // position that lands on the target's top-left texel, so components keep
+    // drawing in window coordinates. Calls may nest.
+    void beginRenderTarget(const RenderTarget& target, int x, int y, bool clear = true) {
+        flushBatch();
+
+        SavedRenderState saved;
+        // Comes from the state cache, GL is only queried the first time after invalidateGLState()
+        saved.framebuffer = currentFramebuffer();
+        getViewport(saved.viewport);
+        getBlendFunc(saved.blend);
+        saved.projection = projection;
+        saved.targetX = renderTargetX;
+        saved.targetY = renderTargetY;
+        saved.targetWidth = renderTargetWidth;
+        saved.targetHeight = renderTargetHeight;
+        // Scissors belong to the framebuffer they were set on
+        saved.scissors.swap(drawList.scissorStack);
+        drawList.clipValid = false;
+        renderStateStack.push_back(std::move(saved));
+        setScissorEnabled(false);
+
+        bindFramebuffer(target.fbo);
+        setViewport(0, 0, target.width, target.height);
+        // Accumulate premultiplied color so the result composites correctly over anything
+        setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        if (clear) {
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+
+        // Same orientation as the window, so texel row 0 is the bottom edge like the default framebuffer
+        projection = glm::ortho(static_cast<float>(x), static_cast<float>(x + target.width),
+            static_cast<float>(y + target.height), static_cast<float>(y));
+        renderTargetX = x;
+        renderTargetY = y;
+        renderTargetWidth = target.width;
+        renderTargetHeight = target.height;
+    }
+
+    void endRenderTarget() {
+        if (renderStateStack.empty()) {
+            return;
+        }
+        flushBatch();
+
+        SavedRenderState saved = std::move(renderStateStack.back());
+        renderStateStack.pop_back();
+        bindFramebuffer(saved.framebuffer);
+        setViewport(saved.viewport[0], saved.viewport[1], saved.viewport[2], saved.viewport[3]);
+        setBlendFunc(saved.blend[0], saved.blend[1], saved.blend[2], saved.blend[3]);
+        projection = saved.projection;
+        renderTargetX = saved.targetX;
+        renderTargetY = saved.targetY;
+        renderTargetWidth = saved.targetWidth;
+        renderTargetHeight = saved.targetHeight;
+        drawList.scissorStack.swap(saved.scissors);
+        drawList.clipValid = false;
+    }
+
+    // Draw a target's texture at (x, y). The texture holds premultiplied color,
+    // so it needs its own blend mode and its own flush.
+    void compositeRenderTarget(const RenderTarget& target, float x, float y, float alpha = 1.0f) {
+        flushBatch();
+        GLint blend[4];
+        getBlendFunc(blend);
+
+        setBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        // v runs bottom up in the texture, the quad's top edge samples v = 1
+        submitQuad(x, y, static_cast<float>(target.width), static_cast<float>(target.height), glm::vec4(alpha), target.texture, glm::vec4(0.0f, 1.0f, 1.0f, 0.0f));
+        flushBatch();
+        setBlendFunc(blend[0], blend[1], blend[2], blend[3]);
+    }
+
+}
@@ -0,0 +1,448 @@
+#pragma once
+#include "atlas_render.h"
+#include <SDL_image.h>
+#include <unordered_map>
+#if defined(__AVX2__)
+#define ATLAS_AVX2
+#include <immintrin.h>
+#endif
+/////////////////////////////////////////////////////////////////////////////////////////
+///////////////ATLAS UI SOFTWARE RASTERIZER//////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////
+// Draws recorded command lists into an RGBA framebuffer on the CPU, for image
+// regression tests and benchmarks. Record as usual with recordingList pointed
+// at your own DrawList, then call rasterizeDrawList. Only rasterizing is GL free:
+// recording still creates glyph pages, images and the white texture on the GPU,
+// so a GL context has to be current (a hidden window is enough). Turn on
+// setSoftTextureMirror first so those textures are copied for the rasterizer.
+namespace Atlas {
+
+    /////////////////////////////////////////////////////////////////
+    ////////////SOFTWARE FRAMEBUFFER////////////////////////////////
+    struct SoftFramebuffer {
+        int width = 0, height = 0;
+        std::vector<uint32_t> pixels; // RGBA bytes, row 0 at the top
+    };
+
+    void resizeSoftFramebuffer(SoftFramebuffer& target, int width, int height) {
+        target.width = std::max(width, 0);
+        target.height = std::max(height, 0);
+        target.pixels.assign(static_cast<size_t>(target.width) * target.height, 0);
+    }
+
+    uint32_t packSoftColor(const glm::vec4& color) {
+        auto channel = [](float value) {
+            return static_cast<uint32_t>(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+        };
+        return channel(color.r) | channel(color.g) << 8 | channel(color.b) << 16 | channel(color.a) << 24;
+    }
+
+    void clearSoftFramebuffer(SoftFramebuffer& target, const glm::vec4& color) {
+        std::fill(target.pixels.begin(), target.pixels.end(), packSoftColor(color));
+    }
+
+    // Writes the framebuffer as a PNG, handy for image regression baselines
+    bool saveSoftFramebuffer(const SoftFramebuffer& target, const std::string& path) {
+        SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(const_cast<uint32_t*>(target.pixels.data()), target.width, target.height,
+            32, target.width * 4, SDL_PIXELFORMAT_RGBA32);
+        if (!surface) {
+            std::cerr << "Failed to wrap software framebuffer: " << SDL_GetError() << std::endl;
+            return false;
+        }
+        bool saved = IMG_SavePNG(surface, path.c_str()) == 0;
+        if (!saved) {
+            std::cerr << "Failed to save " << path << ": " << IMG_GetError() << std::endl;
+        }
+        SDL_FreeSurface(surface);
+        return saved;
+    }
+
+    // Largest difference of any channel of any pixel, -1 when the sizes differ
+    int compareSoftFramebuffers(const SoftFramebuffer& a, const SoftFramebuffer& b) {
+        if (a.width != b.width || a.height != b.height) {
+            return -1;
+        }
+        int largest = 0;
+        for (size_t i = 0; i < a.pixels.size(); i++) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                int difference = static_cast<int>((a.pixels[i] >> shift) & 0xFF) - static_cast<int>((b.pixels[i] >> shift) & 0xFF);
+                largest = std::max(largest, std::abs(difference));
+            }
+        }
+        return largest;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    ////////////SOFTWARE TEXTURES///////////////////////////////////
+    // The CPU copies live in atlas_ui_utilities.h, see setSoftTextureMirror().
+    // Unregistered textures draw as their quad color, like a loading placeholder.
+    const SoftTexture* findSoftTexture(GLuint id) {
+        if (id == 0 || id == quadBatch.whiteTexture) {
+            return nullptr;
+        }
+        auto it = softTextures.find(id);
+        return it == softTextures.end() ? nullptr : &it->second;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    ////////////SPANS///////////////////////////////////////////////
+    // Source over, with the same factors renderUI uses for its render targets:
+    // color SRC_ALPHA, ONE_MINUS_SRC_ALPHA and alpha ONE, ONE_MINUS_SRC_ALPHA.
+    // Sources are straight alpha, 8 bits per channel.
+    uint32_t blendSoftPixel(uint32_t dst, uint32_t src) {
+        uint32_t alpha = src >> 24;
+        uint32_t result = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            uint32_t s = shift == 24 ? 255 : (src >> shift) & 0xFF;
+            uint32_t d = (dst >> shift) & 0xFF;
+            uint32_t value = s * alpha + d * (255 - alpha) + 128;
+            result |= ((value + (value >> 8)) >> 8) << shift;
+        }
+        return result;
+    }
+
+#ifdef ATLAS_SSE2
+    // Blends two pixels widened to 16 bits a channel
+    __m128i blendSoftPair(__m128i src, __m128i dst) {
+        const __m128i opaque = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+        const __m128i colorMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+        __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        src = _mm_or_si128(_mm_and_si128(src, colorMask), opaque);
+        __m128i value = _mm_add_epi16(_mm_mullo_epi16(src, alpha), _mm_mullo_epi16(dst, _mm_sub_epi16(_mm_set1_epi16(255), alpha)));
+        value = _mm_add_epi16(value, _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+    }
+
+    __m128i blendSoftQuad(__m128i src, __m128i dst) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i low = blendSoftPair(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(dst, zero));
+        __m128i high = blendSoftPair(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(dst, zero));
+        return _mm_packus_epi16(low, high);
+    }
+#endif
+
+#ifdef ATLAS_AVX2
+    __m256i blendSoftOctet(__m256i src, __m256i dst) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i opaque = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0);
+        const __m256i colorMask = _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1);
+        __m256i result[2];
+        for (int half = 0; half < 2; half++) {
+            // unpack and pack both work within 128 bit lanes, so the pixel order survives the round trip
+            __m256i s = half ? _mm256_unpackhi_epi8(src, zero) : _mm256_unpacklo_epi8(src, zero);
+            __m256i d = half ? _mm256_unpackhi_epi8(dst, zero) : _mm256_unpacklo_epi8(dst, zero);
+            __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            s = _mm256_or_si256(_mm256_and_si256(s, colorMask), opaque);
+            __m256i value = _mm256_add_epi16(_mm256_mullo_epi16(s, alpha), _mm256_mullo_epi16(d, _mm256_sub_epi16(_mm256_set1_epi16(255), alpha)));
+            value = _mm256_add_epi16(value, _mm256_set1_epi16(128));
+            result[half] = _mm256_srli_epi16(_mm256_add_epi16(value, _mm256_srli_epi16(value, 8)), 8);
+        }
+        return _mm256_packus_epi16(result[0], result[1]);
+    }
+#endif
+
+    // Blends count source pixels over dst
+    void blendSoftSpan(uint32_t* dst, const uint32_t* src, int count) {
+        int i = 0;
+#ifdef ATLAS_AVX2
+        for (; i + 8 <= count; i += 8) {
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+            __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), blendSoftOctet(s, d));
+        }
+#endif
+#ifdef ATLAS_SSE2
+        for (; i + 4 <= count; i += 4) {
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), blendSoftQuad(s, d));
+        }
+#endif
+        for (; i < count; i++) {
+            dst[i] = blendSoftPixel(dst[i], src[i]);
+        }
+    }
+
+    // Blends one color over count pixels, opaque colors are plain stores
+    void fillSoftSpan(uint32_t* dst, uint32_t color, int count) {
+        uint32_t alpha = color >> 24;
+        if (alpha == 0) {
+            return;
+        }
+        int i = 0;
+        if (alpha == 255) {
+#ifdef ATLAS_AVX2
+            const __m256i wide = _mm256_set1_epi32(static_cast<int>(color));
+            for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), wide);
+            }
+#endif
+#ifdef ATLAS_SSE2
+            const __m128i packed = _mm_set1_epi32(static_cast<int>(color));
+            for (; i + 4 <= count; i += 4) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+            }
+#endif
+            for (; i < count; i++) {
+                dst[i] = color;
+            }
+            return;
+        }
+#ifdef ATLAS_AVX2
+        const __m256i wide = _mm256_set1_epi32(static_cast<int>(color));
+        for (; i + 8 <= count; i += 8) {
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), blendSoftOctet(wide, d));
+        }
+#endif
+#ifdef ATLAS_SSE2
+        const __m128i packed = _mm_set1_epi32(static_cast<int>(color));
+        for (; i + 4 <= count; i += 4) {
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), blendSoftQuad(packed, d));
+        }
+#endif
+        for (; i < count; i++) {
+            dst[i] = blendSoftPixel(dst[i], color);
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////
+    ////////////PRIMITIVES//////////////////////////////////////////
+    // Pixels whose centers fall inside rect, limited to clip. False when there are none.
+    bool softPixelRange(const DrawRect& rect, const ScissorRect& clip, int& x0, int& y0, int& x1, int& y1) {
+        x0 = std::max(static_cast<int>(std::ceil(rect.left - 0.5f)), clip.x);
+        y0 = std::max(static_cast<int>(std::ceil(rect.top - 0.5f)), clip.y);
+        x1 = std::min(static_cast<int>(std::ceil(rect.right - 0.5f)), clip.x + clip.width);
+        y1 = std::min(static_cast<int>(std::ceil(rect.bottom - 0.5f)), clip.y + clip.height);
+        return x0 < x1 && y0 < y1;
+    }
+
+    uint32_t modulateSoftColor(uint32_t texel, uint32_t color) {
+        uint32_t result = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            uint32_t value = ((texel >> shift) & 0xFF) * ((color >> shift) & 0xFF) + 128;
+            result |= ((value + (value >> 8)) >> 8) << shift;
+        }
+        return result;
+    }
+
+    // Nearest texel at normalized (u, v), glyph pages read as white with coverage in alpha
+    uint32_t sampleSoftTexture(const SoftTexture& texture, float u, float v) {
+        if (texture.repeat) {
+            u -= std::floor(u);
+            v -= std::floor(v);
+        }
+        int x = std::min(std::max(static_cast<int>(u * texture.width), 0), texture.width - 1);
+        int y = std::min(std::max(static_cast<int>(v * texture.height), 0), texture.height - 1);
+        const unsigned char* texel = &texture.texels[(static_cast<size_t>(y) * texture.width + x) * texture.channels];
+        if (texture.channels == 1) {
+            return 0x00FFFFFFu | static_cast<uint32_t>(texel[0]) << 24;
+        }
+        return texel[0] | texel[1] << 8 | texel[2] << 16 | static_cast<uint32_t>(texel[3]) << 24;
+    }
+
+    // Source pixels for one row, reused so textured spans don't allocate
+    thread_local std::vector<uint32_t> softScratch;
+
+    // A rect, textured when texture is registered. uv is (u0, v0, u1, v1) with v0 at the top edge.
+    void softDrawQuad(SoftFramebuffer& target, const ScissorRect& clip, float x, float y, float w, float h, const glm::vec4& color, GLuint texture, const glm::vec4& uv) {
+        DrawRect rect = { std::min(x, x + w), std::min(y, y + h), std::max(x, x + w), std::max(y, y + h) };
+        int x0, y0, x1, y1;
+        if (w == 0.0f || h == 0.0f || !softPixelRange(rect, clip, x0, y0, x1, y1)) {
+            return;
+        }
+        uint32_t packed = packSoftColor(color);
+        const SoftTexture* source = findSoftTexture(texture);
+        if (!source) {
+            for (int row = y0; row < y1; row++) {
+                fillSoftSpan(&target.pixels[static_cast<size_t>(row) * target.width + x0], packed, x1 - x0);
+            }
+            return;
+        }
+
+        softScratch.resize(x1 - x0);
+        float du = (uv.z - uv.x) / w;
+        float dv = (uv.w - uv.y) / h;
+        for (int row = y0; row < y1; row++) {
+            float v = uv.y + (row + 0.5f - y) * dv;
+            for (int column = x0; column < x1; column++) {
+                float u = uv.x + (column + 0.5f - x) * du;
+                softScratch[column - x0] = modulateSoftColor(sampleSoftTexture(*source, u, v), packed);
+            }
+            blendSoftSpan(&target.pixels[static_cast<size_t>(row) * target.width + x0], softScratch.data(), x1 - x0);
+        }
+    }
+
+    // Atlas texels from distance 0 to 1 in an SDF page, 2 * FontFace::sdfSpread
+    const float softSdfRange = 16.0f;
+
+    float softSmoothstep(float edge0, float edge1, float x) {
+        float t = glm::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+        return t * t * (3.0f - 2.0f * t);
+    }
+
+    // One glyph quad, shaded like the text fragment shader
+    void softDrawGlyph(SoftFramebuffer& target, const ScissorRect& clip, const DrawRect& rect, const glm::vec4& uv, const SoftTexture& page, const TextStyle& style) {
+        int x0, y0, x1, y1;
+        float w = rect.right - rect.left;
+        float h = rect.bottom - rect.top;
+        if (w <= 0.0f || h <= 0.0f || !softPixelRange(rect, clip, x0, y0, x1, y1)) {
+            return;
+        }
+        float du = (uv.z - uv.x) / w;
+        float dv = (uv.w - uv.y) / h;
+        // What fwidth gives the shader: distance covered by one screen pixel
+        float smoothing = std::max(std::abs(du) * page.width / softSdfRange, 0.0001f);
+        float edge = 0.5f - style.outlineWidth;
+
+        softScratch.resize(x1 - x0);
+        for (int row = y0; row < y1; row++) {
+            float v = uv.y + (row + 0.5f - rect.top) * dv;
+            for (int column = x0; column < x1; column++) {
+                float u = uv.x + (column + 0.5f - rect.left) * du;
+                float sample = (sampleSoftTexture(page, u, v) >> 24) / 255.0f;
+                glm::vec4 color(style.color, sample);
+                if (style.sdf) {
+                    float fill = softSmoothstep(0.5f - smoothing, 0.5f + smoothing, sample);
+                    float outer = softSmoothstep(edge - smoothing, edge + smoothing, sample);
+                    glm::vec3 glyph = style.color;
+                    if (style.outlineWidth > 0.0f) {
+                        glyph = glm::vec3(style.outlineColor.x + (style.color.x - style.outlineColor.x) * fill,
+                            style.outlineColor.y + (style.color.y - style.outlineColor.y) * fill,
+                            style.outlineColor.z + (style.color.z - style.outlineColor.z) * fill);
+                    }
+                    float shadowSample = (sampleSoftTexture(page, u - style.shadowOffset.x, v - style.shadowOffset.y) >> 24) / 255.0f;
+                    float shadow = softSmoothstep(edge - smoothing, edge + smoothing, shadowSample) * style.shadowColor.w;
+                    float alpha = outer + shadow * (1.0f - outer);
+                    float scale = 1.0f / std::max(alpha, 0.0001f);
+                    color = glm::vec4((glyph.x * outer + style.shadowColor.x * shadow * (1.0f - outer)) * scale,
+                        (glyph.y * outer + style.shadowColor.y * shadow * (1.0f - outer)) * scale,
+                        (glyph.z * outer + style.shadowColor.z * shadow * (1.0f - outer)) * scale, alpha);
+                }
+                softScratch[column - x0] = packSoftColor(color);
+            }
+            blendSoftSpan(&target.pixels[static_cast<size_t>(row) * target.width + x0], softScratch.data(), x1 - x0);
+        }
+    }
+
+    // Glyph quads are six <pos, uv> vertices, any winding. The corners with the
+    // smallest and largest position carry the uv rect.
+    void softDrawText(SoftFramebuffer& target, const ScissorRect& clip, const glm::vec4* vertices, size_t count, GLuint texture, const TextStyle& style) {
+        const SoftTexture* page = findSoftTexture(texture);
+        if (!page) {
+            return;
+        }
+        for (size_t glyph = 0; glyph + 6 <= count; glyph += 6) {
+            const glm::vec4* quad = vertices + glyph;
+            const glm::vec4* first = quad;
+            const glm::vec4* last = quad;
+            for (int i = 1; i < 6; i++) {
+                if (quad[i].x + quad[i].y < first->x + first->y) {
+                    first = &quad[i];
+                }
+                if (quad[i].x + quad[i].y > last->x + last->y) {
+                    last = &quad[i];
+                }
+            }
+            DrawRect rect = { first->x + style.translate.x, first->y + style.translate.y, last->x + style.translate.x, last->y + style.translate.y };
+            softDrawGlyph(target, clip, rect, glm::vec4(first->z, first->w, last->z, last->w), *page, style);
+        }
+    }
+
+    void softDrawCommand(SoftFramebuffer& target, const DrawList& list, const DrawCommand& command, const ScissorRect& clip) {
+        switch (command.type) {
+        case DRAW_QUADS:
+            for (size_t i = 0; i < command.count; i++) {
+                // submitQuad's corners: 0 is (x, y + h), 1 is (x + w, y + h), 3 is (x, y)
+                const BatchVertex* v = &list.quadVertices[(command.first + i) * 4];
+                softDrawQuad(target, clip, v[3].x, v[3].y, v[1].x - v[3].x, v[1].y - v[3].y,
+                    glm::vec4(v[0].r, v[0].g, v[0].b, v[0].a), command.texture, glm::vec4(v[3].u, v[3].v, v[1].u, v[1].v));
+            }
+            break;
+        case DRAW_INSTANCES:
+            for (size_t i = 0; i < command.count; i++) {
+                const QuadInstance& record = instanceBuffer.records[command.first + i];
+                softDrawQuad(target, clip, record.x, record.y, record.w, record.h,
+                    glm::vec4(record.r, record.g, record.b, record.a), command.texture, glm::vec4(record.u0, record.v0, record.u1, record.v1));
+            }
+            break;
+        case DRAW_TEXT:
+            softDrawText(target, clip, &list.textVertices[command.first], command.count, command.texture, list.styles[command.style]);
+            break;
+        case DRAW_TEXT_MESH:
+            // Meshes keep their vertices on the CPU while setSoftTextureMirror is on
+            if (command.vertices) {
+                softDrawText(target, clip, command.vertices, command.count, command.texture, list.styles[command.style]);
+            }
+            break;
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////
+    ////////////TILE BINNING////////////////////////////////////////
+    // The framebuffer is cut into tiles and every command is listed in the
+    // tiles its bounds touch. Tiles are rasterized in parallel on the worker
+    // pool, each one in command order, so overlapping draws blend as on the GPU.
+    const int softTileSize = 64;
+
+    struct SoftRasterizer {
+        std::vector<int> order;
+        std::vector<std::vector<int>> bins;
+    };
+
+    SoftRasterizer softRasterizer;
+
+    // Draws list into target without consuming it, window coordinates map 1:1 to pixels
+    void rasterizeDrawList(SoftFramebuffer& target, const DrawList& list) {
+        if (list.commands.empty() || target.width <= 0 || target.height <= 0) {
+            return;
+        }
+        SoftRasterizer& rasterizer = softRasterizer;
+        const std::vector<DrawCommand>& commands = list.commands;
+
+        // Layers first, recording order within a layer, same as flushBatch()
+        rasterizer.order.resize(commands.size());
+        for (size_t i = 0; i < commands.size(); i++) {
+            rasterizer.order[i] = static_cast<int>(i);
+        }
+        std::stable_sort(rasterizer.order.begin(), rasterizer.order.end(), [&](int a, int b) { return commands[a].layer < commands[b].layer; });
+
+        int tilesX = (target.width + softTileSize - 1) / softTileSize;
+        int tilesY = (target.height + softTileSize - 1) / softTileSize;
+        rasterizer.bins.resize(static_cast<size_t>(tilesX) * tilesY);
+        for (auto& bin : rasterizer.bins) {
+            bin.clear();
+        }
+        for (int index : rasterizer.order) {
+            const DrawRect& bounds = commands[index].bounds;
+            int left = std::max(static_cast<int>(std::floor(bounds.left)) / softTileSize, 0);
+            int top = std::max(static_cast<int>(std::floor(bounds.top)) / softTileSize, 0);
+            int right = std::min(static_cast<int>(std::ceil(bounds.right)) / softTileSize, tilesX - 1);
+            int bottom = std::min(static_cast<int>(std::ceil(bounds.bottom)) / softTileSize, tilesY - 1);
+            for (int ty = top; ty <= bottom; ty++) {
+                for (int tx = left; tx <= right; tx++) {
+                    rasterizer.bins[static_cast<size_t>(ty) * tilesX + tx].push_back(index);
+                }
+            }
+        }
+
+        workerPool().parallelFor(rasterizer.bins.size(), [&](size_t tileIndex) {
+            const std::vector<int>& bin = rasterizer.bins[tileIndex];
+            if (bin.empty()) {
+                return;
+            }
+            int tx = static_cast<int>(tileIndex % tilesX);
+            int ty = static_cast<int>(tileIndex / tilesX);
+            ScissorRect tile = intersectScissor({ tx * softTileSize, ty * softTileSize, softTileSize, softTileSize }, { 0, 0, target.width, target.height });
+            for (int index : bin) {
+                const DrawCommand& command = commands[index];
+                ScissorRect clip = command.clip >= 0 ? intersectScissor(tile, list.clips[command.clip]) : tile;
+                if (clip.width > 0 && clip.height > 0) {
+                    softDrawCommand(target, list, command, clip);
+                }
+            }
+        });
+    }
+
+}
@@ -1,15 +1,31 @@
 #pragma once
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_MODULE_H
+#ifdef ATLAS_HARFBUZZ
+#include <hb.h>
+#include <hb-ft.h>
+#endif
 #include <map>
+#include <unordered_map>
+#include <cstdint>
+#include <utility>
+#include <list>
+#include <tuple>
+#include <vector>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
+#include <fstream>
+#include <filesystem>
 #include <glm/glm.hpp>
 #include <GL/glew.h>
 #include <GL/gl.h>
 #include <GL/glu.h>
 #include "atlas_ui3.0.h" 
 #include "atlas_ui_utilities.h"
+#include "atlas_render.h"
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -54,10 +70,11 @@ layout(location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>
 out vec2 TexCoords;
 
 uniform mat4 projection;
+uniform vec2 translate;
 
 void main()
 {
-    gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
+    gl_Position = projection * vec4(vertex.xy + translate, 0.0, 1.0);
     TexCoords = vertex.zw;
 }
 )";
@@ -69,213 +86,1396 @@ out vec4 color;
 
 uniform sampler2D text;
 uniform vec3 textColor;
+uniform int sdf;             // 1 when the atlas holds signed distances instead of coverage
+uniform float outlineWidth;  // SDF only, in distance units, 0 disables the outline
+uniform vec3 outlineColor;
+uniform vec2 shadowOffset;   // SDF only, in atlas UV units
+uniform vec4 shadowColor;    // alpha 0 disables the shadow
 
 void main()
 {
-    vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
-    color = vec4(textColor, 1.0) * sampled;
+    if (sdf == 0) {
+        vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
+        color = vec4(textColor, 1.0) * sampled;
+        return;
+    }
+
+    // 0.5 is the glyph edge, fwidth keeps the edge one screen pixel wide at any scale
+    float dist = texture(text, TexCoords).r;
+    float smoothing = max(fwidth(dist), 0.0001);
+    float edge = 0.5 - outlineWidth;
+    float fill = smoothstep(0.5 - smoothing, 0.5 + smoothing, dist);
+    float outer = smoothstep(edge - smoothing, edge + smoothing, dist);
+    vec3 glyphColor = outlineWidth > 0.0 ? mix(outlineColor, textColor, fill) : textColor;
+
+    float shadowDist = texture(text, TexCoords - shadowOffset).r;
+    float shadowAlpha = smoothstep(edge - smoothing, edge + smoothing, shadowDist) * shadowColor.a;
+
+    // Composite the glyph over its shadow
+    float alpha = outer + shadowAlpha * (1.0 - outer);
+    vec3 rgb = (glyphColor * outer + shadowColor.rgb * shadowAlpha * (1.0 - outer)) / max(alpha, 0.0001);
+    color = vec4(rgb, alpha);
 }
 )";
 
-    //Class for text rendering
-    class TextRenderer {
-    public:
-        TextRenderer(float fontSize);
-        ~TextRenderer();
-        void RenderText(const std::string& text, float x, float y, float scale, glm::vec3 color = glm::vec3(0.0f, 0.0f, 0.0f));
+    /////////////////////////////////////////////////////////////////
+    ////////////UTF-8///////////////////////////////////////////////
+    // Decodes the code point starting at text[i] and moves i past it.
+    // Malformed sequences decode to U+FFFD and skip a single byte. That includes
+    // overlong forms, UTF-16 surrogates and anything past U+10FFFF.
+    uint32_t decodeUTF8(const std::string& text, size_t& i) {
+        unsigned char lead = static_cast<unsigned char>(text[i]);
+        size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+        if (length == 0 || i + length > text.size()) {
+            i++;
+            return 0xFFFD;
+        }
+        if (length == 1) {
+            i++;
+            return lead;
+        }
 
+        uint32_t codepoint = lead & (0x7F >> length);
+        for (size_t k = 1; k < length; k++) {
+            unsigned char next = static_cast<unsigned char>(text[i + k]);
+            if ((next & 0xC0) != 0x80) {
+                i++;
+                return 0xFFFD;
+            }
+            codepoint = (codepoint << 6) | (next & 0x3F);
+        }
+        static const uint32_t shortest[] = { 0, 0, 0x80, 0x800, 0x10000 };
+        if (codepoint < shortest[length] || (codepoint >= 0xD800 && codepoint <= 0xDFFF) || codepoint > 0x10FFFF) {
+            i++;
+            return 0xFFFD;
+        }
+        i += length;
+        return codepoint;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    ////////////FONT FACES//////////////////////////////////////////
+    // One font at one raster size. Glyphs are rasterized the first time they
+    // are drawn or measured and packed into fixed size atlas pages. When the
+    // face reaches its memory budget the least recently used page is wiped and
+    // reused. Bitmap faces are rasterized at the size they are drawn at, SDF
+    // faces once at a base size shared by every display size.
+    class FontFace {
+    public:
         struct Character {
-            GLuint TextureID;  // ID handle of the glyph texture
+            GLuint TextureID;  // Atlas page texture holding the glyph
             glm::ivec2 Size;   // Size of glyph
             glm::ivec2 Bearing; // Offset from baseline to left/top of glyph
             GLuint Advance;    // Offset to advance to next glyph
+            glm::vec4 UV;      // Glyph rect in the page (u0, v0, u1, v1)
+            int page;          // Index of the atlas page, -1 for blank glyphs such as space
+        };
+
+        FontFace(const std::string& fontPath, int pixelSize, bool sdf);
+        ~FontFace();
+
+        // Faces are shared by every TextRenderer drawing the same font at the same raster size
+        static FontFace* Acquire(const std::string& fontPath, int pixelSize, bool sdf);
+        static void Release(FontFace* face);
+
+        // Atlas memory each face may use before it starts evicting pages
+        static void SetCacheBudget(size_t bytes);
+
+        // Directory for baked atlas files, empty disables the disk cache
+        static void SetCacheDirectory(const std::string& directory);
+
+        static const int sdfSpread = 8; // Distance in raster pixels covered by an SDF glyph's falloff
+        static const int pageSize = 512; // Atlas pages are pageSize x pageSize, one byte per texel
+
+        // Glyph keys are code points, or glyphIndexFlag | glyph index for glyphs
+        // that came out of the shaper and have no code point of their own
+        static const uint32_t glyphIndexFlag = 0x80000000;
+
+        // Returns the glyph, rasterizing it into an atlas page on a miss
+        Character GetGlyph(uint32_t key);
+
+        // A shaped string. Positions are in raster pixels from the pen origin, y up.
+        struct ShapedGlyph {
+            uint32_t key;
+            float x, y;
+        };
+        struct ShapedRun {
+            std::vector<ShapedGlyph> glyphs;
+            float advance = 0.0f;
+        };
+
+        // Shapes UTF-8 text with HarfBuzz when built with ATLAS_HARFBUZZ, otherwise
+        // lays it out with the font's kerning pairs. Results are cached per string,
+        // the reference stays valid until the next Shape call.
+        const ShapedRun& Shape(const std::string& text);
+
+        // Rasterizes every missing code point across the worker pool, then packs
+        // and uploads them on the calling thread
+        void LoadGlyphs(const std::vector<uint32_t>& codepoints);
+
+        // Starts a new LRU tick. Pages used during the current tick are never
+        // evicted, so call this once per string before looking its glyphs up.
+        void BeginUse() { useTick++; }
+
+        std::string fontPath;
+        int pixelSize;
+        bool sdf;
+        int atlasWidth = pageSize, atlasHeight = pageSize;
+        float lineHeight = 0.0f, ascender = 0.0f, descender = 0.0f; // Raster pixels, descender is negative
+        uint32_t generation = 0; // Bumped on every eviction, retained vertex data must be rebuilt
+        std::recursive_mutex mutex; // Held by TextRenderer around shaping and glyph lookups, widgets may record on several threads
+
+    private:
+        struct AtlasPage {
+            GLuint texture;
+            ShelfPacker packer;
+            uint64_t lastUsed;
+        };
+
+        FT_Library ft;
+        FT_Face face;
+        bool freeTypeLoaded = false; // Only opened when a glyph is missing from the baked atlas
+        uint64_t fontHash = 0;
+        bool atlasCacheDirty = false; // Glyphs were packed since the baked atlas was written
+
+        std::vector<Character> glyphs;         // Glyph slots
+        std::vector<uint32_t> slotCodepoints;  // Code point held by each slot, freeSlot when unused
+        std::vector<int> freeSlots;
+        std::vector<int> directSlots;          // Code points below directLimit -> slot, -1 when not cached
+        std::unordered_map<uint32_t, int> slotMap; // Everything above directLimit
+        std::vector<AtlasPage> pages;
+        uint64_t useTick = 1;
+
+        static const uint32_t directLimit = 0x800; // Latin, Greek, Cyrillic, Hebrew, Arabic...
+        static const uint32_t freeSlot = 0xFFFFFFFF;
+        static size_t cacheBudget;
+        static std::string cacheDirectory;
+
+        // Shaped run cache, most recently used at the front
+        struct ShapedRunEntry {
+            uint64_t hash;
+            std::string text;
+            ShapedRun run;
+        };
+        std::list<ShapedRunEntry> shapedRuns;
+        std::unordered_map<uint64_t, std::list<ShapedRunEntry>::iterator> shapedRunIndex;
+        ShapedRun refusedRun; // Returned instead of a cache entry when recording refused a glyph
+        static const size_t shapedRunLimit = 2048;
+
+        // 26.6 kerning between printable ASCII pairs, [left * 128 + right]. Empty when
+        // the font has no kerning. Kept so a baked face can kern without FreeType.
+        std::vector<int32_t> asciiKerning;
+        void LoadMetrics();
+        void LoadKerning();
+        float Kerning(uint32_t left, uint32_t right);
+        void ShapeRun(const std::string& text, ShapedRun& run);
+#ifdef ATLAS_HARFBUZZ
+        hb_font_t* hbFont = nullptr;
+        hb_buffer_t* hbBuffer = nullptr;
+#endif
+
+        void LoadFreeType();
+        void LoadCharacters();
+        std::string CachePath() const;
+        bool LoadAtlasCache();
+        void SaveAtlasCache();
+        static void SaveChangedAtlasCaches();
+        int StoreGlyph(uint32_t codepoint, const Character& character);
+        int FindSlot(uint32_t codepoint);
+        struct GlyphBitmap {
+            uint32_t codepoint = 0;
+            bool loaded = false;
+            int width = 0, rows = 0;
+            glm::ivec2 bearing = glm::ivec2(0);
+            GLuint advance = 0;
+            std::vector<unsigned char> pixels;
+        };
+
+        static void RasterizeGlyph(FT_Face rasterFace, uint32_t codepoint, bool sdf, GlyphBitmap& out);
+        int PlaceGlyph(const GlyphBitmap& bitmap, int& page, int& x, int& y);
+        int LoadGlyph(uint32_t codepoint);
+        bool AllocateGlyph(int w, int h, int& page, int& x, int& y);
+        void AddPage(const unsigned char* texels = nullptr); // Cleared when texels is null
+        void EvictPage(int page);
+
+        struct FaceEntry {
+            FontFace* face;
+            int refCount;
+        };
+        static std::map<std::tuple<std::string, int, bool>, FaceEntry> faceRegistry;
+    };
+
+    size_t FontFace::cacheBudget = 4 * 1024 * 1024;
+    std::string FontFace::cacheDirectory;
+    std::map<std::tuple<std::string, int, bool>, FontFace::FaceEntry> FontFace::faceRegistry;
+
+    FontFace::FontFace(const std::string& fontPath, int pixelSize, bool sdf)
+        : fontPath(fontPath), pixelSize(pixelSize), sdf(sdf), directSlots(directLimit, -1) {
+        if (fontPath.empty()) {
+            throw std::runtime_error("ERROR::FREETYPE: Global font path is not set");
+        }
+
+        if (!cacheDirectory.empty()) {
+            MappedFile fontFile(fontPath);
+            if (!fontFile.isOpen()) {
+                throw std::runtime_error("ERROR::FREETYPE: Failed to load font");
+            }
+            fontHash = hashBytes(fontFile.data(), fontFile.size());
+
+            // Faces that are never released still write their lazily loaded glyphs back
+            static bool hooked = false;
+            if (!hooked) {
+                shutdownHooks().push_back([] { SaveChangedAtlasCaches(); });
+                hooked = true;
+            }
+
+            // A baked atlas for this exact font file skips FreeType entirely
+            if (LoadAtlasCache()) {
+                return;
+            }
+        }
+
+        LoadCharacters();
+        LoadMetrics();
+        LoadKerning();
+        if (!cacheDirectory.empty()) {
+            SaveAtlasCache();
+        }
+    }
+
+    FontFace::~FontFace() {
+        // Glyphs loaded lazily since construction go into the next run's baked atlas
+        if (atlasCacheDirty) {
+            SaveAtlasCache();
+        }
+        for (auto& page : pages) {
+            removeSoftTexture(page.texture);
+            forgetTexture(page.texture);
+            glDeleteTextures(1, &page.texture);
+        }
+#ifdef ATLAS_HARFBUZZ
+        if (hbFont) {
+            hb_buffer_destroy(hbBuffer);
+            hb_font_destroy(hbFont);
+        }
+#endif
+        // The face stays open for the renderer's lifetime so missing glyphs can be loaded lazily
+        if (freeTypeLoaded) {
+            FT_Done_Face(face);
+            FT_Done_FreeType(ft);
+        }
+    }
+
+    void FontFace::LoadFreeType() {
+        if (freeTypeLoaded) {
+            return;
+        }
+
+        if (FT_Init_FreeType(&ft)) {
+            throw std::runtime_error("ERROR::FREETYPE: Could not init FreeType Library");
+        }
+
+        if (FT_New_Face(ft, fontPath.c_str(), 0, &face)) {
+            FT_Done_FreeType(ft);
+            throw std::runtime_error("ERROR::FREETYPE: Failed to load font");
+        }
+
+        if (sdf) {
+            FT_Int spread = sdfSpread;
+            FT_Property_Set(ft, "sdf", "spread", &spread);
+        }
+
+        FT_Set_Pixel_Sizes(face, 0, static_cast<FT_UInt>(pixelSize));
+        freeTypeLoaded = true;
+    }
+
+    FontFace* FontFace::Acquire(const std::string& fontPath, int pixelSize, bool sdf) {
+        auto key = std::make_tuple(fontPath, pixelSize, sdf);
+        auto it = faceRegistry.find(key);
+        if (it != faceRegistry.end()) {
+            it->second.refCount++;
+            return it->second.face;
+        }
+
+        FontFace* face = new FontFace(fontPath, pixelSize, sdf);
+        faceRegistry[key] = { face, 1 };
+        return face;
+    }
+
+    void FontFace::Release(FontFace* face) {
+        if (!face) {
+            return;
+        }
+        auto it = faceRegistry.find(std::make_tuple(face->fontPath, face->pixelSize, face->sdf));
+        if (it == faceRegistry.end() || it->second.face != face) {
+            delete face;
+            return;
+        }
+        if (--it->second.refCount == 0) {
+            faceRegistry.erase(it);
+            delete face;
+        }
+    }
+
+    void FontFace::SetCacheBudget(size_t bytes) {
+        cacheBudget = bytes;
+    }
+
+    void FontFace::SetCacheDirectory(const std::string& directory) {
+        cacheDirectory = directory;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    ////////////BAKED ATLAS CACHE///////////////////////////////////
+    // File layout: header, packer state per page, glyph metrics, ASCII kerning
+    // pairs, then the raw R8 texels of every page back to back.
+    struct AtlasCacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t fontHash;
+        int32_t pixelSize;
+        int32_t sdf;
+        int32_t sdfSpread;
+        int32_t pageSize;
+        uint32_t pageCount;
+        uint32_t glyphCount;
+        uint32_t kerningCount;
+        int32_t lineHeight, ascender, descender; // 26.6
+    };
+
+    struct AtlasCachePage {
+        int32_t cursorX, cursorY, shelfHeight;
+    };
+
+    struct AtlasCacheGlyph {
+        uint32_t codepoint;
+        int32_t page;
+        int32_t sizeX, sizeY;
+        int32_t bearingX, bearingY;
+        int32_t x, y;
+        uint32_t advance;
+    };
+
+    struct AtlasCacheKerning {
+        uint32_t pair; // left * 128 + right
+        int32_t amount;
+    };
+
+    const uint32_t atlasCacheVersion = 3;
+
+    std::string FontFace::CachePath() const {
+        // The path hash keeps same named fonts from different folders apart
+        std::string name = std::filesystem::path(fontPath).stem().string();
+        uint32_t pathHash = static_cast<uint32_t>(hashBytes(fontPath.data(), fontPath.size()));
+        return (std::filesystem::path(cacheDirectory) / (name + "_" + std::to_string(pathHash) + "_" + std::to_string(pixelSize) + (sdf ? "_sdf" : "") + ".glyphs")).string();
+    }
+
+    bool FontFace::LoadAtlasCache() {
+        MappedFile file(CachePath());
+        if (!file.isOpen() || file.size() < sizeof(AtlasCacheHeader)) {
+            return false;
+        }
+
+        AtlasCacheHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        if (memcmp(header.magic, "AGLY", 4) != 0 || header.version != atlasCacheVersion
+            || header.fontHash != fontHash || header.pixelSize != pixelSize || header.sdf != (sdf ? 1 : 0)
+            || header.sdfSpread != sdfSpread || header.pageSize != pageSize) {
+            return false; // Stale, it gets rebuilt and overwritten
+        }
+
+        size_t pageBytes = static_cast<size_t>(pageSize) * pageSize;
+        size_t pagesOffset = sizeof(AtlasCacheHeader);
+        size_t glyphsOffset = pagesOffset + header.pageCount * sizeof(AtlasCachePage);
+        size_t kerningOffset = glyphsOffset + header.glyphCount * sizeof(AtlasCacheGlyph);
+        size_t texelsOffset = kerningOffset + header.kerningCount * sizeof(AtlasCacheKerning);
+        if (file.size() != texelsOffset + header.pageCount * pageBytes) {
+            return false;
+        }
+
+        // Upload straight from the mapping
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (uint32_t i = 0; i < header.pageCount; i++) {
+            AtlasCachePage state;
+            memcpy(&state, file.data() + pagesOffset + i * sizeof(AtlasCachePage), sizeof(state));
+
+            AddPage(file.data() + texelsOffset + i * pageBytes);
+            pages.back().packer.cursorX = state.cursorX;
+            pages.back().packer.cursorY = state.cursorY;
+            pages.back().packer.shelfHeight = state.shelfHeight;
+        }
+
+        for (uint32_t i = 0; i < header.glyphCount; i++) {
+            AtlasCacheGlyph record;
+            memcpy(&record, file.data() + glyphsOffset + i * sizeof(AtlasCacheGlyph), sizeof(record));
+
+            Character character = { 0, glm::ivec2(record.sizeX, record.sizeY), glm::ivec2(record.bearingX, record.bearingY),
+                record.advance, glm::vec4(0.0f), -1 };
+            if (record.page >= 0 && static_cast<uint32_t>(record.page) < header.pageCount) {
+                character.TextureID = pages[record.page].texture;
+                character.UV = glm::vec4(
+                    static_cast<float>(record.x) / pageSize,
+                    static_cast<float>(record.y) / pageSize,
+                    static_cast<float>(record.x + record.sizeX) / pageSize,
+                    static_cast<float>(record.y + record.sizeY) / pageSize);
+                character.page = record.page;
+            }
+            StoreGlyph(record.codepoint, character);
+        }
+
+        lineHeight = header.lineHeight / 64.0f;
+        ascender = header.ascender / 64.0f;
+        descender = header.descender / 64.0f;
+
+        if (header.kerningCount > 0) {
+            asciiKerning.assign(128 * 128, 0);
+        }
+        for (uint32_t i = 0; i < header.kerningCount; i++) {
+            AtlasCacheKerning record;
+            memcpy(&record, file.data() + kerningOffset + i * sizeof(AtlasCacheKerning), sizeof(record));
+            if (record.pair < asciiKerning.size()) {
+                asciiKerning[record.pair] = record.amount;
+            }
+        }
+        return true;
+    }
+
+    void FontFace::SaveChangedAtlasCaches() {
+        for (auto& entry : faceRegistry) {
+            if (entry.second.face->atlasCacheDirty) {
+                entry.second.face->SaveAtlasCache();
+            }
+        }
+    }
+
+    void FontFace::SaveAtlasCache() {
+        if (cacheDirectory.empty() || fontHash == 0) {
+            return; // The directory was set after this face was created, there is no hash to key it by
+        }
+        atlasCacheDirty = false;
+
+        std::error_code error;
+        std::filesystem::create_directories(cacheDirectory, error);
+
+        AtlasCacheHeader header = {};
+        memcpy(header.magic, "AGLY", 4);
+        header.version = atlasCacheVersion;
+        header.fontHash = fontHash;
+        header.pixelSize = pixelSize;
+        header.sdf = sdf ? 1 : 0;
+        header.sdfSpread = sdfSpread;
+        header.pageSize = pageSize;
+        header.pageCount = static_cast<uint32_t>(pages.size());
+        header.lineHeight = static_cast<int32_t>(lineHeight * 64.0f);
+        header.ascender = static_cast<int32_t>(ascender * 64.0f);
+        header.descender = static_cast<int32_t>(descender * 64.0f);
+
+        std::vector<AtlasCacheGlyph> records;
+        for (size_t slot = 0; slot < glyphs.size(); slot++) {
+            if (slotCodepoints[slot] == freeSlot) {
+                continue;
+            }
+            const Character& ch = glyphs[slot];
+            records.push_back({ slotCodepoints[slot], ch.page, ch.Size.x, ch.Size.y, ch.Bearing.x, ch.Bearing.y,
+                static_cast<int32_t>(ch.UV.x * pageSize + 0.5f), static_cast<int32_t>(ch.UV.y * pageSize + 0.5f), ch.Advance });
+        }
+        header.glyphCount = static_cast<uint32_t>(records.size());
+
+        std::vector<AtlasCacheKerning> kerning;
+        for (size_t pair = 0; pair < asciiKerning.size(); pair++) {
+            if (asciiKerning[pair] != 0) {
+                kerning.push_back({ static_cast<uint32_t>(pair), asciiKerning[pair] });
+            }
+        }
+        header.kerningCount = static_cast<uint32_t>(kerning.size());
+
+        // Write to a temporary file first so a crash never leaves a half written cache
+        std::string path = CachePath();
+        std::string tempPath = path + ".tmp";
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Failed to write glyph cache: " << tempPath << std::endl;
+            return;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& page : pages) {
+            AtlasCachePage state = { page.packer.cursorX, page.packer.cursorY, page.packer.shelfHeight };
+            out.write(reinterpret_cast<const char*>(&state), sizeof(state));
+        }
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(AtlasCacheGlyph));
+        out.write(reinterpret_cast<const char*>(kerning.data()), kerning.size() * sizeof(AtlasCacheKerning));
+
+        std::vector<unsigned char> texels(static_cast<size_t>(pageSize) * pageSize);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        for (const auto& page : pages) {
+            bindTexture(page.texture);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+            out.write(reinterpret_cast<const char*>(texels.data()), texels.size());
+        }
+        out.close();
+
+        std::filesystem::rename(tempPath, path, error);
+        if (error) {
+            std::cerr << "Failed to write glyph cache: " << path << std::endl;
+            std::filesystem::remove(tempPath, error);
+        }
+    }
+
+    // Printable ASCII is used by nearly every string, so warm it up front
+    void FontFace::LoadCharacters() {
+        std::vector<uint32_t> ascii;
+        for (uint32_t c = 32; c < 127; c++) {
+            ascii.push_back(c);
+        }
+        LoadGlyphs(ascii);
+    }
+
+    int FontFace::FindSlot(uint32_t codepoint) {
+        if (codepoint < directLimit) {
+            return directSlots[codepoint];
+        }
+        auto it = slotMap.find(codepoint);
+        return it != slotMap.end() ? it->second : -1;
+    }
+
+    FontFace::Character FontFace::GetGlyph(uint32_t codepoint) {
+        int slot = FindSlot(codepoint);
+        if (slot < 0) {
+            slot = LoadGlyph(codepoint);
+        }
+        if (slot < 0) {
+            return { 0, glm::ivec2(0), glm::ivec2(0), 0, glm::vec4(0.0f), -1 }; // Refused off the GL thread, loaded on the retry
+        }
+        const Character& ch = glyphs[slot];
+        if (ch.page >= 0) {
+            pages[ch.page].lastUsed = useTick;
+        }
+        return ch;
+    }
+
+    // CPU half of loading a glyph. Touches no shared state, so workers can run it
+    // with their own FT_Face.
+    void FontFace::RasterizeGlyph(FT_Face rasterFace, uint32_t codepoint, bool sdf, GlyphBitmap& out) {
+        out.codepoint = codepoint;
+        out.loaded = false;
+        FT_Int32 loadFlags = sdf ? FT_LOAD_DEFAULT : FT_LOAD_RENDER;
+        FT_Error error = (codepoint & glyphIndexFlag)
+            ? FT_Load_Glyph(rasterFace, codepoint & ~glyphIndexFlag, loadFlags)
+            : FT_Load_Char(rasterFace, codepoint, loadFlags);
+        if (error
+            || (sdf && FT_Render_Glyph(rasterFace->glyph, FT_RENDER_MODE_SDF))) {
+            return;
+        }
+
+        FT_GlyphSlot glyph = rasterFace->glyph;
+        FT_Bitmap& bitmap = glyph->bitmap;
+        out.width = static_cast<int>(bitmap.width);
+        out.rows = static_cast<int>(bitmap.rows);
+        out.bearing = glm::ivec2(glyph->bitmap_left, glyph->bitmap_top);
+        out.advance = static_cast<GLuint>(glyph->advance.x);
+        out.pixels.resize(static_cast<size_t>(out.width) * out.rows);
+        for (int row = 0; row < out.rows; row++) {
+            memcpy(&out.pixels[static_cast<size_t>(row) * out.width], bitmap.buffer + row * bitmap.pitch, out.width);
+        }
+        out.loaded = true;
+    }
+
+    // GL half, packs the bitmap into a page and caches it. The texel upload is left
+    // to the caller so a batch of glyphs can be uploaded together.
+    int FontFace::PlaceGlyph(const GlyphBitmap& bitmap, int& page, int& x, int& y) {
+        // Failed glyphs are cached as blanks so they are not retried every frame
+        Character character = { 0, glm::ivec2(0), glm::ivec2(0), 0, glm::vec4(0.0f), -1 };
+        page = -1;
+
+        if (!bitmap.loaded) {
+            std::cerr << "ERROR::FREETYPE: Failed to load Glyph " << bitmap.codepoint << std::endl;
+        }
+        else {
+            character.Size = glm::ivec2(bitmap.width, bitmap.rows);
+            character.Bearing = bitmap.bearing;
+            character.Advance = bitmap.advance;
+
+            if (bitmap.width > 0 && bitmap.rows > 0 && AllocateGlyph(bitmap.width, bitmap.rows, page, x, y)) {
+                character.TextureID = pages[page].texture;
+                character.UV = glm::vec4(
+                    static_cast<float>(x) / pageSize,
+                    static_cast<float>(y) / pageSize,
+                    static_cast<float>(x + bitmap.width) / pageSize,
+                    static_cast<float>(y + bitmap.rows) / pageSize);
+                character.page = page;
+            }
+            else if (bitmap.width > 0 && bitmap.rows > 0 && recordingOffThread) {
+                return -1; // Needs a new page, not cached so the GL thread loads it again
+            }
+            else if (bitmap.width > 0 && bitmap.rows > 0) {
+                std::cerr << "ERROR::FREETYPE: Glyph " << bitmap.codepoint << " does not fit in an atlas page" << std::endl;
+                character.Size = glm::ivec2(0);
+                page = -1;
+            }
+        }
+
+        atlasCacheDirty = true;
+        return StoreGlyph(bitmap.codepoint, character);
+    }
+
+    int FontFace::LoadGlyph(uint32_t codepoint) {
+        LoadFreeType();
+        GlyphBitmap bitmap;
+        RasterizeGlyph(face, codepoint, sdf, bitmap);
+
+        int page, x, y;
+        int slot = PlaceGlyph(bitmap, page, x, y);
+        if (page >= 0) {
+            // Off the GL thread the texels land before anything recorded this frame is drawn
+            GLuint texture = pages[page].texture;
+            auto bitmapShared = std::make_shared<GlyphBitmap>(std::move(bitmap));
+            deferGL([texture, x, y, bitmapShared] {
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Disable byte-alignment restriction
+                bindTexture(texture);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, bitmapShared->width, bitmapShared->rows, GL_RED, GL_UNSIGNED_BYTE, bitmapShared->pixels.data());
+                if (mirrorSoftTextures) {
+                    updateSoftTexture(texture, x, y, bitmapShared->width, bitmapShared->rows, bitmapShared->pixels.data());
+                }
+            });
+        }
+        return slot;
+    }
+
+    void FontFace::LoadGlyphs(const std::vector<uint32_t>& codepoints) {
+        std::vector<uint32_t> missing;
+        for (uint32_t codepoint : codepoints) {
+            if (FindSlot(codepoint) < 0 && std::find(missing.begin(), missing.end(), codepoint) == missing.end()) {
+                missing.push_back(codepoint);
+            }
+        }
+        if (missing.empty()) {
+            return;
+        }
+
+        // FreeType objects are not thread safe, so every chunk opens its own face
+        // over one in-memory copy of the font file
+        MappedFile fontFile(fontPath);
+        if (!fontFile.isOpen()) {
+            std::cerr << "ERROR::FREETYPE: Failed to load font" << std::endl;
+            return;
+        }
+
+        std::vector<GlyphBitmap> bitmaps(missing.size());
+        ThreadPool& pool = workerPool();
+        size_t chunkCount = std::min(pool.size() + 1, (missing.size() + 15) / 16);
+        pool.parallelFor(chunkCount, [&](size_t chunk) {
+            FT_Library library;
+            FT_Face chunkFace;
+            if (FT_Init_FreeType(&library)) {
+                return;
+            }
+            if (FT_New_Memory_Face(library, fontFile.data(), static_cast<FT_Long>(fontFile.size()), 0, &chunkFace)) {
+                FT_Done_FreeType(library);
+                return;
+            }
+            if (sdf) {
+                FT_Int spread = sdfSpread;
+                FT_Property_Set(library, "sdf", "spread", &spread);
+            }
+            FT_Set_Pixel_Sizes(chunkFace, 0, static_cast<FT_UInt>(pixelSize));
+
+            for (size_t i = chunk; i < missing.size(); i += chunkCount) {
+                RasterizeGlyph(chunkFace, missing[i], sdf, bitmaps[i]);
+            }
+
+            FT_Done_Face(chunkFace);
+            FT_Done_FreeType(library);
+        });
+
+        // Pack everything, then upload page by page
+        BeginUse();
+        struct Placement {
+            int page, x, y;
         };
-        float GetCharacterWidth(char c) {
+        std::vector<Placement> placements(bitmaps.size());
+        for (size_t i = 0; i < bitmaps.size(); i++) {
+            bitmaps[i].codepoint = missing[i]; // Set even when the chunk failed to open the font
+            PlaceGlyph(bitmaps[i], placements[i].page, placements[i].x, placements[i].y);
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t page = 0; page < pages.size(); page++) {
+            bool bound = false;
+            for (size_t i = 0; i < bitmaps.size(); i++) {
+                if (placements[i].page != static_cast<int>(page)) {
+                    continue;
+                }
+                if (!bound) {
+                    bindTexture(pages[page].texture);
+                    bound = true;
+                }
+                glTexSubImage2D(GL_TEXTURE_2D, 0, placements[i].x, placements[i].y, bitmaps[i].width, bitmaps[i].rows,
+                    GL_RED, GL_UNSIGNED_BYTE, bitmaps[i].pixels.data());
+                if (mirrorSoftTextures) {
+                    updateSoftTexture(pages[page].texture, placements[i].x, placements[i].y, bitmaps[i].width, bitmaps[i].rows, bitmaps[i].pixels.data());
+                }
+            }
+        }
+    }
+
+    int FontFace::StoreGlyph(uint32_t codepoint, const Character& character) {
+        int slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            glyphs[slot] = character;
+            slotCodepoints[slot] = codepoint;
+        }
+        else {
+            slot = static_cast<int>(glyphs.size());
+            glyphs.push_back(character);
+            slotCodepoints.push_back(codepoint);
+        }
+
+        if (codepoint < directLimit) {
+            directSlots[codepoint] = slot;
+        }
+        else {
+            slotMap[codepoint] = slot;
+        }
+        return slot;
+    }
+
+    bool FontFace::AllocateGlyph(int w, int h, int& page, int& x, int& y) {
+        if (w + 1 > pageSize || h + 1 > pageSize) {
+            return false;
+        }
+
+        size_t maxPages = std::max<size_t>(1, cacheBudget / (static_cast<size_t>(pageSize) * pageSize));
+        for (;;) {
+            // Newest page first, older pages are usually full
+            for (int i = static_cast<int>(pages.size()) - 1; i >= 0; i--) {
+                if (pages[i].packer.pack(w, h, x, y)) {
+                    page = i;
+                    pages[i].lastUsed = useTick;
+                    return true;
+                }
+            }
+
+            int victim = -1;
+            for (size_t i = 0; i < pages.size(); i++) {
+                if (pages[i].lastUsed < useTick && (victim < 0 || pages[i].lastUsed < pages[victim].lastUsed)) {
+                    victim = static_cast<int>(i);
+                }
+            }
+
+            if (recordingOffThread) {
+                refuseRecording(); // New pages and evictions need GL
+                return false;
+            }
+
+            // Go over budget rather than evict glyphs the current string is using,
+            // or anything recorded earlier in a frame that holds eviction
+            if (pages.size() < maxPages || victim < 0 || holdGlyphEviction) {
+                AddPage();
+            }
+            else {
+                EvictPage(victim);
+            }
+        }
+    }
+
+    void FontFace::AddPage(const unsigned char* texels) {
+        std::vector<unsigned char> clear;
+        if (!texels) {
+            clear.assign(static_cast<size_t>(pageSize) * pageSize, 0);
+            texels = clear.data();
+        }
+
+        AtlasPage page = { 0, ShelfPacker(pageSize, pageSize), useTick };
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glGenTextures(1, &page.texture);
+        bindTexture(page.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, pageSize, pageSize, 0, GL_RED, GL_UNSIGNED_BYTE, texels);
+        if (mirrorSoftTextures) {
+            setSoftTexture(page.texture, pageSize, pageSize, 1, texels);
+        }
+        // Set texture options
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        pages.push_back(page);
+    }
+
+    // Drops every glyph on the page and hands the space back to the packer
+    void FontFace::EvictPage(int page) {
+        flushBatch(); // Text recorded this frame may still sample the old glyphs
+        for (size_t slot = 0; slot < glyphs.size(); slot++) {
+            if (slotCodepoints[slot] == freeSlot || glyphs[slot].page != page) {
+                continue;
+            }
+            uint32_t codepoint = slotCodepoints[slot];
+            if (codepoint < directLimit) {
+                directSlots[codepoint] = -1;
+            }
+            else {
+                slotMap.erase(codepoint);
+            }
+            slotCodepoints[slot] = freeSlot;
+            freeSlots.push_back(static_cast<int>(slot));
+        }
+
+        // Clear the old texels so linear filtering at glyph edges does not pick them up
+        std::vector<unsigned char> clear(static_cast<size_t>(pageSize) * pageSize, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        bindTexture(pages[page].texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pageSize, pageSize, GL_RED, GL_UNSIGNED_BYTE, clear.data());
+        if (mirrorSoftTextures) {
+            updateSoftTexture(pages[page].texture, 0, 0, pageSize, pageSize, clear.data());
+        }
+
+        pages[page].packer = ShelfPacker(pageSize, pageSize);
+        pages[page].lastUsed = useTick;
+        generation++;
+        glyphAtlasGeneration++;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    ////////////TEXT SHAPING////////////////////////////////////////
+
+    void FontFace::LoadMetrics() {
+        LoadFreeType();
+        lineHeight = face->size->metrics.height / 64.0f;
+        ascender = face->size->metrics.ascender / 64.0f;
+        descender = face->size->metrics.descender / 64.0f;
+    }
+
+    void FontFace::LoadKerning() {
+        LoadFreeType();
+        if (!FT_HAS_KERNING(face)) {
+            return;
+        }
+
+        asciiKerning.assign(128 * 128, 0);
+        for (uint32_t left = 32; left < 127; left++) {
+            FT_UInt leftIndex = FT_Get_Char_Index(face, left);
+            for (uint32_t right = 32; right < 127; right++) {
+                FT_Vector delta;
+                if (!FT_Get_Kerning(face, leftIndex, FT_Get_Char_Index(face, right), FT_KERNING_DEFAULT, &delta)) {
+                    asciiKerning[left * 128 + right] = static_cast<int32_t>(delta.x);
+                }
+            }
+        }
+    }
+
+    float FontFace::Kerning(uint32_t left, uint32_t right) {
+        if (left < 128 && right < 128) {
+            return asciiKerning.empty() ? 0.0f : asciiKerning[left * 128 + right] / 64.0f;
+        }
+
+        LoadFreeType();
+        FT_Vector delta;
+        if (!FT_HAS_KERNING(face)
+            || FT_Get_Kerning(face, FT_Get_Char_Index(face, left), FT_Get_Char_Index(face, right), FT_KERNING_DEFAULT, &delta)) {
+            return 0.0f;
+        }
+        return delta.x / 64.0f;
+    }
+
+    const FontFace::ShapedRun& FontFace::Shape(const std::string& text) {
+        uint64_t hash = hashBytes(text.data(), text.size());
+        auto found = shapedRunIndex.find(hash);
+        if (found != shapedRunIndex.end() && found->second->text == text) {
+            shapedRuns.splice(shapedRuns.begin(), shapedRuns, found->second);
+            return found->second->run;
+        }
+
+        if (found != shapedRunIndex.end()) {
+            shapedRuns.erase(found->second); // Hash collision, replace the old string
+            shapedRunIndex.erase(found);
+        }
+        else if (shapedRuns.size() >= shapedRunLimit) {
+            shapedRunIndex.erase(shapedRuns.back().hash);
+            shapedRuns.pop_back();
+        }
+
+        shapedRuns.push_front({ hash, text, ShapedRun() });
+        shapedRunIndex[hash] = shapedRuns.begin();
+        bool refusedBefore = recordingRefused;
+        recordingRefused = false;
+        ShapeRun(text, shapedRuns.front().run);
+        if (recordingRefused) {
+            // Refused glyphs have no advance yet, keep this layout out of the cache
+            refusedRun = std::move(shapedRuns.front().run);
+            shapedRunIndex.erase(hash);
+            shapedRuns.pop_front();
+            return refusedRun;
+        }
+        recordingRefused = refusedBefore;
+        return shapedRuns.front().run;
+    }
+
+#ifdef ATLAS_HARFBUZZ
+    void FontFace::ShapeRun(const std::string& text, ShapedRun& run) {
+        LoadFreeType();
+        if (!hbFont) {
+            hbFont = hb_ft_font_create_referenced(face);
+            hbBuffer = hb_buffer_create();
+        }
+
+        hb_buffer_reset(hbBuffer);
+        hb_buffer_add_utf8(hbBuffer, text.c_str(), static_cast<int>(text.size()), 0, static_cast<int>(text.size()));
+        hb_buffer_guess_segment_properties(hbBuffer);
+        hb_shape(hbFont, hbBuffer, nullptr, 0);
+
+        unsigned int count = 0;
+        hb_glyph_info_t* infos = hb_buffer_get_glyph_infos(hbBuffer, &count);
+        hb_glyph_position_t* positions = hb_buffer_get_glyph_positions(hbBuffer, &count);
+
+        // HarfBuzz positions are 26.6 at the face's pixel size
+        float pen = 0.0f;
+        for (unsigned int i = 0; i < count; i++) {
+            run.glyphs.push_back({ glyphIndexFlag | infos[i].codepoint,
+                pen + positions[i].x_offset / 64.0f, positions[i].y_offset / 64.0f });
+            pen += positions[i].x_advance / 64.0f;
+        }
+        run.advance = pen;
+    }
+#else
+    // Without a shaper each code point maps to one glyph, spaced by its advance and kerning
+    void FontFace::ShapeRun(const std::string& text, ShapedRun& run) {
+        float pen = 0.0f;
+        uint32_t previous = 0;
+        for (size_t i = 0; i < text.size();) {
+            uint32_t codepoint = decodeUTF8(text, i);
+            if (previous) {
+                pen += Kerning(previous, codepoint);
+            }
+            run.glyphs.push_back({ codepoint, pen, 0.0f });
+            pen += GetGlyph(codepoint).Advance / 64.0f;
+            previous = codepoint;
+        }
+        run.advance = pen;
+    }
+#endif
+
+    class TextMesh;
+
+    // SDF mode only, ignored by bitmap faces. Widths and offsets are in screen pixels.
+    // Passed with each draw, so renderers shared through the registry never share a style.
+    struct TextEffects {
+        float outlineWidth = 0.0f;
+        glm::vec3 outlineColor = glm::vec3(0.0f, 0.0f, 0.0f);
+        glm::vec2 shadowOffset = glm::vec2(0.0f);
+        glm::vec4 shadowColor = glm::vec4(0.0f); // alpha 0 disables the shadow
+    };
+
+    //Class for text rendering
+    class TextRenderer {
+    public:
+        using Character = FontFace::Character;
+
+        TextRenderer(float fontSize, const std::string& fontPath = "");
+        ~TextRenderer();
+
+        // Shared renderers keyed by (font path, pixel size, SDF mode). Every Acquire must be
+        // paired with a Release; the renderer is destroyed with its last reference.
+        static TextRenderer* Acquire(float fontSize, const std::string& fontPath = "");
+        static void Release(TextRenderer* renderer);
+
+        // Renderers created while SDF mode is on share one distance field face per font,
+        // rasterized at baseSize and scaled to each fontSize. Set it before building the UI.
+        static void SetSDFMode(bool enabled, int baseSize = 48);
+
+        // Atlas memory each font face may use before cold glyphs are evicted. Defaults to 4MB.
+        static void SetGlyphCacheBudget(size_t bytes) { FontFace::SetCacheBudget(bytes); }
+
+        // Bake each font's atlas into this directory and load it from there on later
+        // runs, skipping FreeType. Rebuilt whenever the font file changes. Glyphs loaded
+        // later are written back when the face is released or at Shutdown. Off by default.
+        static void SetGlyphCacheDirectory(const std::string& directory) { FontFace::SetCacheDirectory(directory); }
+
+        // Rasterizes the glyphs of a UTF-8 string up front, in parallel, so the first
+        // frame that shows localized text does not load them one by one
+        void PreloadGlyphs(const std::string& text) {
+            std::vector<uint32_t> codepoints;
+            for (size_t i = 0; i < text.size();) {
+                codepoints.push_back(decodeUTF8(text, i));
+            }
+            std::lock_guard<std::recursive_mutex> lock(font->mutex);
+            font->LoadGlyphs(codepoints);
+        }
+
+        void RenderText(const std::string& text, float x, float y, float scale, glm::vec3 color = glm::vec3(0.0f, 0.0f, 0.0f), const TextEffects& effects = TextEffects());
+
+        // Vertices that sample the same atlas page, drawn with one call
+        struct TextRun {
+            GLuint texture;
+            GLint first;
+            GLsizei count;
+        };
+
+        // Appends six <pos, uv> vertices per visible glyph of the UTF-8 text, grouped
+        // by atlas page, and returns how many were added. runs receives one entry per page.
+        size_t BuildTextVertices(const std::string& text, float x, float y, float scale, std::vector<glm::vec4>& vertices, std::vector<TextRun>* runs = nullptr);
+
+        float GetCharacterWidth(uint32_t codepoint) {
             // Get the character width
-            return Characters[c].Advance >> 6;
+            std::lock_guard<std::recursive_mutex> lock(font->mutex);
+            return (font->GetGlyph(codepoint).Advance >> 6) * displayScale;
         }
 
+        // Width of the shaped string and height of its tallest glyph
+        struct TextExtents {
+            float width;
+            float height;
+        };
+
+        // Extents are cached per string, so measuring the same text every frame is a lookup
+        TextExtents Measure(const std::string& text);
+
+        // Shaped width, kerning and ligatures included, so it matches what RenderText draws
         float GetTextWidth(const std::string& text) {
-            float width = 0.0f;
-            for (char c : text) {
-                width += GetCharacterWidth(c); // Call the method to get the width of each character
-            }
-            return width;
+            return Measure(text).width;
         }
         static void SetGlobalFont(const std::string& fontPath);
 
         float GetTextHeight(const std::string& text)
         {
-            float height = 0.0f;
-            for (char c : text) {
-
-                if (Characters[c].Size.y > height) {
-                    height = Characters[c].Size.y;
-                }
-            }
-            return height;
+            return Measure(text).height;
         }
+
+        // Face metrics, use these to space lines rather than measuring a sample string
+        float GetLineHeight() const { return font->lineHeight * displayScale; }
+        float GetAscender() const { return font->ascender * displayScale; }
+        float GetDescender() const { return font->descender * displayScale; }
     private:
-        FT_Library ft;
-        FT_Face face;
-        std::map<char, Character> Characters;
-        GLuint VAO, VBO;
-        GLuint textShaderProgram; // New shader program for text rendering
+        friend class TextMesh;
 
-        void LoadCharacters();
-        void SetupRenderData();
+        FontFace* font = nullptr;
+        float displayScale = 1.0f; // fontSize / raster size, 1 for bitmap faces
+        GLuint textShaderProgram; // Shared by every renderer, see SharedShaderProgram()
+        std::vector<glm::vec4> vertexScratch; // Reused by RenderText to avoid per call allocations
+        std::vector<TextRun> runScratch;
+        std::unordered_map<std::string, TextExtents> measureCache;
+        static const size_t measureCacheLimit = 4096;
+
+        struct PlacedGlyph {
+            Character ch;
+            float x, y; // Pen position of the glyph
+            bool emitted;
+        };
+        std::vector<PlacedGlyph> glyphScratch;
+        std::string fontPath;
+        int pixelSize;
+        bool sdf; // SDF mode when created, part of the registry key
+
+        TextStyle StyleFor(const glm::vec3& color, const TextEffects& effects) const;
+
+        static GLuint SharedShaderProgram();
 
         static std::string globalFontPath; // Static member to store the global font path
+        static bool sdfMode;
+        static int sdfBaseSize;
+
+        struct FontEntry {
+            TextRenderer* renderer;
+            int refCount;
+        };
+        static std::map<std::tuple<std::string, int, bool>, FontEntry> fontRegistry;
 
     };
 
     std::string TextRenderer::globalFontPath = "UI/svf.ttf";
+    bool TextRenderer::sdfMode = false;
+    int TextRenderer::sdfBaseSize = 48;
+    std::map<std::tuple<std::string, int, bool>, TextRenderer::FontEntry> TextRenderer::fontRegistry;
 
 
-    TextRenderer::TextRenderer(float fontSize) {
-        if (FT_Init_FreeType(&ft)) {
-            throw std::runtime_error("ERROR::FREETYPE: Could not init FreeType Library");
-        }
+    TextRenderer::TextRenderer(float fontSize, const std::string& fontPath)
+        : fontPath(fontPath.empty() ? globalFontPath : fontPath), pixelSize(static_cast<int>(fontSize)), sdf(sdfMode) {
+        int rasterSize = sdfMode ? sdfBaseSize : pixelSize;
+        font = FontFace::Acquire(this->fontPath, rasterSize, sdfMode);
+        displayScale = static_cast<float>(pixelSize) / static_cast<float>(rasterSize);
 
-        if (globalFontPath.empty()) {
-            throw std::runtime_error("ERROR::FREETYPE: Global font path is not set");
-        }
+        textShaderProgram = SharedShaderProgram();
+    }
 
-        if (FT_New_Face(ft, globalFontPath.c_str(), 0, &face)) {
-            throw std::runtime_error("ERROR::FREETYPE: Failed to load font");
+    // One text shader for the whole process, compiled by the first renderer
+    GLuint TextRenderer::SharedShaderProgram() {
+        static GLuint program = createTextShaderProgram(textVertexShaderSource, textFragmentShaderSource);
+        return program;
+    }
+
+    TextRenderer* TextRenderer::Acquire(float fontSize, const std::string& fontPath) {
+        auto key = std::make_tuple(fontPath.empty() ? globalFontPath : fontPath, static_cast<int>(fontSize), sdfMode);
+        auto it = fontRegistry.find(key);
+        if (it != fontRegistry.end()) {
+            it->second.refCount++;
+            return it->second.renderer;
         }
 
-        FT_Set_Pixel_Sizes(face, 0, static_cast<FT_UInt>(fontSize));
-        LoadCharacters();
-        SetupRenderData();
+        TextRenderer* renderer = new TextRenderer(fontSize, std::get<0>(key));
+        fontRegistry[key] = { renderer, 1 };
+        return renderer;
+    }
 
-        // Create the text shader program
-        textShaderProgram = createTextShaderProgram(textVertexShaderSource, textFragmentShaderSource);
+    void TextRenderer::Release(TextRenderer* renderer) {
+        if (!renderer) {
+            return;
+        }
+        auto it = fontRegistry.find(std::make_tuple(renderer->fontPath, renderer->pixelSize, renderer->sdf));
+        if (it == fontRegistry.end() || it->second.renderer != renderer) {
+            delete renderer; // Not registry owned, created with new TextRenderer
+            return;
+        }
+        if (--it->second.refCount == 0) {
+            fontRegistry.erase(it);
+            delete renderer;
+        }
     }
 
     void TextRenderer::SetGlobalFont(const std::string& fontPath) {
         globalFontPath = fontPath;
     }
 
+    void TextRenderer::SetSDFMode(bool enabled, int baseSize) {
+        sdfMode = enabled;
+        sdfBaseSize = baseSize;
+    }
+
 
     TextRenderer::~TextRenderer() {
-        FT_Done_Face(face);
-        FT_Done_FreeType(ft);
-        glDeleteProgram(textShaderProgram); // Clean up the shader program
+        FontFace::Release(font);
     }
 
-    void TextRenderer::LoadCharacters() {
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Disable byte-alignment restriction
+    TextRenderer::TextExtents TextRenderer::Measure(const std::string& text) {
+        std::lock_guard<std::recursive_mutex> lock(font->mutex); // Also guards this renderer's caches
+        auto found = measureCache.find(text);
+        if (found != measureCache.end()) {
+            return found->second;
+        }
+
+        // Plain reset rather than LRU, only screens with thousands of unique strings get here
+        if (measureCache.size() >= measureCacheLimit) {
+            measureCache.clear();
+        }
 
-        for (unsigned char c = 0; c < 128; c++) {
-            // Load character glyph
-            if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
-                std::cerr << "ERROR::FREETYPE: Failed to load Glyph" << std::endl;
-                continue;
+        bool refusedBefore = recordingRefused;
+        recordingRefused = false;
+        const FontFace::ShapedRun& run = font->Shape(text);
+        float height = 0.0f;
+        font->BeginUse();
+        for (const auto& glyph : run.glyphs) {
+            height = std::max(height, static_cast<float>(font->GetGlyph(glyph.key).Size.y));
+        }
+
+        TextExtents extents = { run.advance * displayScale, height * displayScale };
+        if (!recordingRefused) {
+            measureCache.emplace(text, extents); // Refused glyphs measure as blanks, the retry measures again
+        }
+        recordingRefused = recordingRefused || refusedBefore;
+        return extents;
+    }
+
+    size_t TextRenderer::BuildTextVertices(const std::string& text, float x, float y, float scale, std::vector<glm::vec4>& vertices, std::vector<TextRun>* runs) {
+        std::lock_guard<std::recursive_mutex> lock(font->mutex);
+        size_t first = vertices.size();
+        scale *= displayScale;
+
+        // Place the shaped glyphs first, blank glyphs such as space take no quad
+        font->BeginUse();
+        glyphScratch.clear();
+        for (const auto& glyph : font->Shape(text).glyphs) {
+            Character ch = font->GetGlyph(glyph.key);
+            if (ch.page >= 0) {
+                glyphScratch.push_back({ ch, x + glyph.x * scale, y - glyph.y * scale, false });
             }
-            // Generate texture
-            GLuint texture;
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glTexImage2D(
-                GL_TEXTURE_2D,
-                0,
-                GL_RED,
-                face->glyph->bitmap.width,
-                face->glyph->bitmap.rows,
-                0,
-                GL_RED,
-                GL_UNSIGNED_BYTE,
-                face->glyph->bitmap.buffer
-            );
-            // Set texture options
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            // Now store character for later use
-            Character character = {
-                texture,
-                glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-                glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-                static_cast<unsigned int>(face->glyph->advance.x)
-            };
-            Characters.insert(std::pair<char, Character>(c, character));
-        }
-        glBindTexture(GL_TEXTURE_2D, 0); // Unbind texture
-        FT_Done_Face(face);
-        FT_Done_FreeType(ft);
-    }
-
-    void TextRenderer::SetupRenderData() {
-        // Configure VAO/VBO for texture quads
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-    }
-
-    void TextRenderer::RenderText(const std::string& text, float x, float y, float scale, glm::vec3 color) {
-        glUseProgram(textShaderProgram);
-        GLint textColorLocation = glGetUniformLocation(textShaderProgram, "textColor");
-        glUniform3f(textColorLocation, color.x, color.y, color.z);
-
-        GLint projectionLocation = glGetUniformLocation(textShaderProgram, "projection");
-        glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
-
-        glUniform1i(glGetUniformLocation(textShaderProgram, "text"), 0); // Use text texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindVertexArray(VAO);
-
-        GLenum error = glGetError();
-
-
-        std::string::const_iterator c;
-        for (c = text.begin(); c != text.end(); c++) {
-            Character ch = Characters[*c];
-
-            float xpos = x + ch.Bearing.x * scale;
-            float ypos = y - (ch.Bearing.y * scale); // Adjusted for baseline alignment
-
-            float w = ch.Size.x * scale;
-            float h = ch.Size.y * scale;
-
-            float vertices[6][4] = {
-                { xpos,     ypos + h,   0.0f, 1.0f },
-                { xpos,     ypos,       0.0f, 0.0f },
-                { xpos + w, ypos,       1.0f, 0.0f },
-
-                { xpos,     ypos + h,   0.0f, 1.0f },
-                { xpos + w, ypos,       1.0f, 0.0f },
-                { xpos + w, ypos + h,   1.0f, 1.0f }
-            };
-            glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+        }
+
+        // Emit page by page so each page needs one draw, almost always there is just one
+        size_t remaining = glyphScratch.size();
+        while (remaining > 0) {
+            int page = -1;
+            GLuint texture = 0;
+            size_t runFirst = vertices.size();
+            for (auto& glyph : glyphScratch) {
+                if (glyph.emitted || (page >= 0 && glyph.ch.page != page)) {
+                    continue;
+                }
+                page = glyph.ch.page;
+                texture = glyph.ch.TextureID;
+                glyph.emitted = true;
+                remaining--;
 
-            error = glGetError();
+                const Character& ch = glyph.ch;
+                float xpos = glyph.x + ch.Bearing.x * scale;
+                float ypos = glyph.y - (ch.Bearing.y * scale); // Adjusted for baseline alignment
 
+                float w = ch.Size.x * scale;
+                float h = ch.Size.y * scale;
+
+                vertices.push_back(glm::vec4(xpos,     ypos + h, ch.UV.x, ch.UV.w));
+                vertices.push_back(glm::vec4(xpos,     ypos,     ch.UV.x, ch.UV.y));
+                vertices.push_back(glm::vec4(xpos + w, ypos,     ch.UV.z, ch.UV.y));
+
+                vertices.push_back(glm::vec4(xpos,     ypos + h, ch.UV.x, ch.UV.w));
+                vertices.push_back(glm::vec4(xpos + w, ypos,     ch.UV.z, ch.UV.y));
+                vertices.push_back(glm::vec4(xpos + w, ypos + h, ch.UV.z, ch.UV.w));
+            }
+            if (runs) {
+                runs->push_back({ texture, static_cast<GLint>(runFirst), static_cast<GLsizei>(vertices.size() - runFirst) });
+            }
+        }
+        return vertices.size() - first;
+    }
 
-            x += (ch.Advance >> 6) * scale;
+    // Uniforms shared by RenderText and TextMesh::Draw
+    TextStyle TextRenderer::StyleFor(const glm::vec3& color, const TextEffects& effects) const {
+        TextStyle style;
+        style.color = color;
+        style.sdf = font->sdf ? 1 : 0;
+        if (font->sdf) {
+            // Screen pixels -> raster pixels -> normalized distance (0.5 is the edge)
+            style.outlineWidth = (effects.outlineWidth / displayScale) / (2.0f * FontFace::sdfSpread);
+            style.outlineColor = effects.outlineColor;
+            // Screen pixels -> atlas texels -> UV units
+            style.shadowOffset = glm::vec2(effects.shadowOffset.x / displayScale / font->atlasWidth, effects.shadowOffset.y / displayScale / font->atlasHeight);
+            style.shadowColor = effects.shadowColor;
         }
-        glBindVertexArray(0);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        return style;
+    }
 
-        error = glGetError();
+    void TextRenderer::RenderText(const std::string& text, float x, float y, float scale, glm::vec3 color, const TextEffects& effects) {
+        std::lock_guard<std::recursive_mutex> lock(font->mutex); // The scratch buffers are shared by every user of this renderer
+        vertexScratch.clear();
+        runScratch.clear();
+        if (BuildTextVertices(text, x, y, scale, vertexScratch, &runScratch) == 0) {
+            return;
+        }
 
+        // Recorded into the command list, runs of matching style and page share a draw
+        TextStyle style = StyleFor(color, effects);
+        for (const auto& run : runScratch) {
+            submitText(textShaderProgram, run.texture, style, vertexScratch.data() + run.first, run.count);
+        }
     }
 
 
 
+    /////////////////////////////////////////////////////////////////
+    ////////////RETAINED TEXT MESH//////////////////////////////////
+    // Keeps the vertex data of a string in its own GPU buffer. The text is
+    // measured when it changes and re-meshed only when the text, font or
+    // position changes, so static labels cost a single draw per frame.
+    class TextMesh {
+    public:
+        TextMesh() = default;
+        TextMesh(const TextMesh&) = delete;
+        TextMesh& operator=(const TextMesh&) = delete;
+
+        ~TextMesh() {
+            if (VBO) {
+                glDeleteBuffers(1, &VBO);
+            }
+            if (VAO) {
+                forgetVertexArray(VAO);
+                glDeleteVertexArrays(1, &VAO);
+            }
+        }
+
+        void SetText(TextRenderer* newRenderer, const std::string& newText) {
+            if (newRenderer == renderer && newText == text && measured) {
+                return;
+            }
+            renderer = newRenderer;
+            text = newText;
+            width = renderer ? renderer->GetTextWidth(text) : 0.0f;
+            height = renderer ? renderer->GetTextHeight(text) : 0.0f;
+            measured = true;
+            dirty = true;
+        }
+
+        void SetPosition(float newX, float newY) {
+            if (newX != x || newY != y) {
+                x = newX;
+                y = newY;
+                dirty = true;
+            }
+        }
+
+        float GetWidth() const { return width; }
+        float GetHeight() const { return height; }
+
+        void Draw(const glm::vec3& color, const TextEffects& effects = TextEffects()) {
+            if (!renderer) {
+                return;
+            }
+            // An atlas eviction may have moved our glyphs
+            if (dirty || generation != renderer->font->generation) {
+                Rebuild();
+            }
+            if (runs.empty()) {
+                return;
+            }
+
+            TextStyle style = renderer->StyleFor(color, effects);
+            for (size_t i = 0; i < runs.size(); i++) {
+                if (uploadPending) {
+                    // Rebuilt on a worker, stream this frame's copy until the buffer is filled
+                    submitText(renderer->textShaderProgram, runs[i].texture, style, vertices.data() + runs[i].first, runs[i].count);
+                }
+                else {
+                    const glm::vec4* copy = vertices.empty() ? nullptr : vertices.data() + runs[i].first;
+                    submitTextMesh(renderer->textShaderProgram, VAO, runs[i].texture, style, runs[i].first, runs[i].count, runBounds[i], copy);
+                }
+            }
+        }
+
+    private:
+        TextRenderer* renderer = nullptr;
+        std::string text;
+        float x = 0.0f, y = 0.0f;
+        float width = 0.0f, height = 0.0f;
+        bool measured = false;
+        bool dirty = true;
+        GLuint VAO = 0, VBO = 0;
+        std::vector<TextRenderer::TextRun> runs;
+        std::vector<DrawRect> runBounds;
+        std::vector<glm::vec4> vertices; // Held until uploaded, or kept for the software rasterizer while mirroring
+        bool uploadPending = false;
+        uint32_t generation = 0;
+
+        void Rebuild() {
+            vertices.clear();
+            runs.clear();
+            renderer->BuildTextVertices(text, x, y, 1.0f, vertices, &runs);
+            runBounds.clear();
+            for (const auto& run : runs) {
+                runBounds.push_back(vertexBounds(vertices.data() + run.first, run.count));
+            }
+            generation = renderer->font->generation;
+            dirty = recordingRefused; // Glyphs refused off the GL thread are missing, build again on the retry
 
+            uploadPending = true;
+            deferGL([this] { Upload(); });
+        }
 
+        void Upload() {
+            if (!VAO) {
+                glGenVertexArrays(1, &VAO);
+                glGenBuffers(1, &VBO);
+                bindVertexArray(VAO);
+                glBindBuffer(GL_ARRAY_BUFFER, VBO);
+                glEnableVertexAttribArray(0);
+                glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+                bindVertexArray(0);
+            }
 
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec4), vertices.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            if (!mirrorSoftTextures) {
+                std::vector<glm::vec4>().swap(vertices);
+            }
+            uploadPending = false;
+        }
+    };
 
 }
@@ -19,6 +19,7 @@
 #include <functional>
 #include <string>
 #include "atlas_ui_utilities.h"
+#include "atlas_render.h"
 #include "atlas_text.h"
 #include <filesystem>
 
@@ -34,8 +35,10 @@ namespace Atlas {
 
     void setProjectionMatrix(int screenWidth, int screenHeight) {
         projection = glm::ortho(0.0f, static_cast<float>(screenWidth), static_cast<float>(screenHeight), 0.0f);
-        glUseProgram(shaderProgram);
-        GLint projLoc = glGetUniformLocation(shaderProgram, "projection");
+        renderTargetWidth = screenWidth;
+        renderTargetHeight = screenHeight;
+        useProgram(shaderProgram);
+        GLint projLoc = uniformLocation(shaderProgram, "projection");
         if (projLoc == -1) {
             std::cerr << "Failed to find 'projection' uniform location!" << std::endl;
         }
@@ -51,12 +54,20 @@ namespace Atlas {
         float x = 0.0f, y = 0.0f; // Initialized
         int width = 0, height = 0; // Initialized
         Widget* parent = nullptr;
+        virtual ~UIComponent() = default; // Widgets delete components through this base
         virtual void Draw() = 0;
         virtual void handleEvents(SDL_Event* event) = 0;
         virtual void updatePosition(float deltaX, float deltaY) {
             x += deltaX;
             y += deltaY;
         }
+
+        // Call after any change that alters what Draw() produces, so a cached parent re-renders
+        void markDirty();
+
+        // Milliseconds until this component's next visual change, -1 when none is
+        // scheduled. 0 means it is due, and its widget gets redrawn.
+        virtual int animationDelay() const { return -1; }
     };
 
     struct DraggableComponent {
@@ -68,7 +79,7 @@ namespace Atlas {
 
     struct Widget {
         int x = 0, y = 0, width = 0, height = 0, ID = 0;
-        GLuint texture = 0;
+        Texture* texture = nullptr; // Shared through TextureCache
         bool isResizing = false;
         bool resizingLeft = false, resizingRight = false, resizingTop = false, resizingBottom = false;
         std::vector<UIComponent*> components;
@@ -80,12 +91,24 @@ namespace Atlas {
         bool isVisable = true;
 
         glm::vec4 color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f); //default color
-        
-       
+
+        // Render-to-texture cache, enabled with WIDGET_CACHED. While clean the
+        // widget costs one textured quad per frame.
+        bool isCached = false;
+        bool isDirty = true;
+        RenderTarget cache;
+
+        // Uncached widgets keep their last recording, with the quads in the
+        // instance buffer. Reused until the widget is marked dirty.
+        RetainedList retained;
+
+        // Re-render the cache and damage the widget's screen rect
+        void markDirty();
 
         void setColor(float r, float g, float b, float a)
         {
             color = glm::vec4(r, g, b, a);
+            markDirty();
         }
         ~Widget() {
         
@@ -99,6 +122,47 @@ namespace Atlas {
         Widget* currentWidget = nullptr; // Track the current widget context
         bool isCreatingWidget = false;
 
+        // The whole UI is kept in one window-sized target, and each frame only the
+        // damaged part of it is cleared and redrawn. Back buffers are undefined
+        // after a swap, so they can't be patched directly.
+        RenderTarget frame;
+        ScissorRect damage; // Union of everything invalidated since the last renderUI()
+
+        // Components can draw a little past their widget (borders, focus outlines).
+        // Anything further out is clipped, so a redraw never leaves stale pixels behind.
+        static const int damageMargin = 4;
+
+        void addDamage(int x, int y, int width, int height) {
+            if (width <= 0 || height <= 0) {
+                return;
+            }
+            if (damage.width <= 0 || damage.height <= 0) {
+                damage = ScissorRect{ x, y, width, height };
+                return;
+            }
+            int right = std::max(damage.x + damage.width, x + width);
+            int bottom = std::max(damage.y + damage.height, y + height);
+            damage.x = std::min(damage.x, x);
+            damage.y = std::min(damage.y, y);
+            damage.width = right - damage.x;
+            damage.height = bottom - damage.y;
+        }
+
+        void damageWidget(const Widget& widget) {
+            ScissorRect clip = widgetClip(widget);
+            addDamage(clip.x, clip.y, clip.width, clip.height);
+        }
+
+        // The most a widget may draw over, its rect grown by damageMargin
+        ScissorRect widgetClip(const Widget& widget) const {
+            return ScissorRect{ widget.x - damageMargin, widget.y - damageMargin, widget.width + damageMargin * 2, widget.height + damageMargin * 2 };
+        }
+
+        bool isDamaged(const Widget& widget) const {
+            return widget.x - damageMargin < damage.x + damage.width && widget.x + widget.width + damageMargin > damage.x &&
+                widget.y - damageMargin < damage.y + damage.height && widget.y + widget.height + damageMargin > damage.y;
+        }
+
         // Function to determine and set the active widget based on mouse position and z-order
         void setActiveWidget(int mouseX, int mouseY) {
             Widget* topWidget = nullptr;
@@ -116,9 +180,20 @@ namespace Atlas {
         }
     };
 
+    void UIComponent::markDirty() {
+        if (parent) {
+            parent->markDirty();
+        }
+    }
+
     // Global UIManager instance
     UIManager uiManager;
 
+    void Widget::markDirty() {
+        isDirty = true;
+        uiManager.damageWidget(*this);
+    }
+
     // Flags for widget options
     enum WidgetOptions {
         WIDGET_NONE = 0,
@@ -130,7 +205,8 @@ namespace Atlas {
         WIDGET_PASSWORD = 1 << 5,
         WIDGET_CLOSEABLE = 1 << 6,
         WIDGET_SHOWN = 1 << 7,
-        WIDGET_HIDDEN = 1 << 8
+        WIDGET_HIDDEN = 1 << 8,
+        WIDGET_CACHED = 1 << 9 // Draw into an offscreen texture, redrawn only when a component changes
     };
 
 
@@ -176,9 +252,13 @@ namespace Atlas {
                 // Calculate the delta movement
                 int deltaX = mouseX - draggable.offsetX - parent.x;
                 int deltaY = mouseY - draggable.offsetY - parent.y;
+                // Uncover where the widget was and draw it where it lands. Its cache
+                // moves with it, so it stays clean.
+                uiManager.damageWidget(parent);
                 // Update widget position
                 parent.x = mouseX - draggable.offsetX;
                 parent.y = mouseY - draggable.offsetY;
+                uiManager.damageWidget(parent);
                 // Update positions of all components relative to the new widget position
                 for (auto component : parent.components) {
                     component->updatePosition(deltaX, deltaY);
@@ -294,7 +374,8 @@ void main()
         glewInit();
 
         shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
-     
+        initQuadBatch(createShaderProgram(batchVertexShaderSource, batchFragmentShaderSource));
+        initInstanceBuffer(createShaderProgram(instanceVertexShaderSource, batchFragmentShaderSource));
         
         float vertices[] = {
             // positions    // texture coords
@@ -312,7 +393,7 @@ void main()
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        bindVertexArray(VAO);
 
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
@@ -340,12 +421,14 @@ void main()
         float fontSize;
         TextRenderer* textRenderer;
         glm::vec3 color;
+        TextEffects effects; // Outline and shadow, SDF mode only
+        TextMesh textMesh; // Retained vertex data, rebuilt only when the text or position changes
 
         TextComponent(const std::string& text, float fontSize, float x = 0.0f, float y = 0.0f, glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f))
             : UIComponent(), text(text), fontSize(fontSize), color(color) {
             this->x = x;
             this->y = y;
-            textRenderer = new TextRenderer(fontSize);
+            textRenderer = TextRenderer::Acquire(fontSize);
         }
 
         virtual void Draw() override {
@@ -356,7 +439,9 @@ void main()
                     globalX += parent->x;
                     globalY += parent->y;
                 }
-                textRenderer->RenderText(text, globalX, globalY, 1.0f, color);
+                textMesh.SetText(textRenderer, text);
+                textMesh.SetPosition(globalX, globalY);
+                textMesh.Draw(color, effects);
             }
         }
 
@@ -370,11 +455,14 @@ void main()
         }
 
         void setText(const std::string& newText) {
-            text = newText;
+            if (text != newText) {
+                text = newText;
+                markDirty();
+            }
         }
 
         ~TextComponent() {
-            delete textRenderer;
+            TextRenderer::Release(textRenderer);
         }
     };
 
@@ -384,7 +472,7 @@ void main()
     // /////////////////////////////BUTTON COMPONENT OF WIDGETS///////////////////////////////
     // //////////////////////////////////////////////////////////////////////////////////////
     struct ButtonComponent : public UIComponent {
-        GLuint texture = 0;
+        Texture* texture = nullptr;
         std::function<void()> onClick;
         bool hasTexture = false; // New flag to indicate if the button has a texture
         int width;
@@ -396,6 +484,8 @@ void main()
         glm::vec3 textColor;
         glm::vec4 buttonColor = glm::vec4(0.5f, 0.5f, 0.5f,0.5f); // Default button color
         TextRenderer* textRenderer;
+        TextEffects effects;
+        TextMesh textMesh;
         bool isHovered;
 
         ButtonComponent(const std::string& text, float fontSize, const std::string& texturePath = "", std::function<void()> onClick = nullptr, int width = 100, int height = 50, int x = 0, int y = 0, glm::vec3 textColor = glm::vec3(1.0f, 1.0f, 1.0f))
@@ -406,83 +496,56 @@ void main()
             this->x = x;
             this->y = y;
 
-            textRenderer = new TextRenderer(fontSize);
+            textRenderer = TextRenderer::Acquire(fontSize);
 
             // Load the texture if a path is provided and it's not empty
-            if (!texturePath.empty()) {
-                SDL_Surface* surface = IMG_Load(texturePath.c_str());
-                if (surface) {
-                    glGenTextures(1, &texture);
-                    glBindTexture(GL_TEXTURE_2D, texture);
-
-                    GLenum format = surface->format->BytesPerPixel == 4 ? GL_RGBA : GL_RGB;
-                    glTexImage2D(GL_TEXTURE_2D, 0, format, surface->w, surface->h, 0, format, GL_UNSIGNED_BYTE, surface->pixels);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-                    SDL_FreeSurface(surface);
-                    hasTexture = true; // Texture successfully loaded
-                }
-                else {
-                    std::cerr << "Failed to load texture " << IMG_GetError() << std::endl;
-                }
-            }
+            texture = TextureCache::Acquire(texturePath, TEXTURE_ASYNC, width, height);
+            hasTexture = texture != nullptr;
         }
 
         virtual void Draw() override {
             // Draw the button texture if it exists
             if (hasTexture) {
-                glUseProgram(shaderProgram);
-                glBindVertexArray(VAO);
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, texture);
-                glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-                glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 1);
-
                 float globalX = parent->x + x;
                 float globalY = parent->y + y;
 
-                glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(globalX, globalY, 0.0f));
-                model = glm::scale(model, glm::vec3(width, height, 1.0f)); // Use button's width and height
-                GLuint modelLoc = glGetUniformLocation(shaderProgram, "model");
-                glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+                if (texture->resident) {
+                    submitQuad(globalX, globalY, width, height, glm::vec4(1.0f), texture->id, texture->uv); // Use button's width and height
+                }
+                else {
+                    submitQuad(globalX, globalY, width, height, TextureCache::placeholderColor); // Still loading
+                }
             }
             else {
-                glUseProgram(shaderProgram);
-                glBindVertexArray(VAO);
-
                 // Draw the border
-                glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0);
-                glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.0f, 0.0f, 0.0f, 1.0f); // Border color
-
-                glm::mat4 borderModel = glm::translate(glm::mat4(1.0f), glm::vec3(parent->x + x, parent->y + y, 0.0f));
-                borderModel = glm::scale(borderModel, glm::vec3(width + 4.0f, height + 4.0f, 1.0f));
-                glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(borderModel));
-                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+                submitQuad(parent->x + x, parent->y + y, width + 4.0f, height + 4.0f, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)); // Border color
 
                 // Draw the button itself
                 glm::vec4 buttonColor = isHovered ? glm::vec4(0.7f, 0.7f, 0.7f, 1.0f) : glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
-                glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), buttonColor.r, buttonColor.g, buttonColor.b, buttonColor.a);
-
-                glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(parent->x + x, parent->y + y, 0.0f));
-                model = glm::scale(model, glm::vec3(width, height, 1.0f));
-                glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+                submitQuad(parent->x + x, parent->y + y, width, height, buttonColor);
             }
 
 
             // Draw the text directly using TextRenderer
             if (textRenderer) {
-                float textWidth = textRenderer->GetTextWidth(text);
-                float textHeight = textRenderer->GetTextHeight(text);
+                // Measured once per text change by the mesh
+                textMesh.SetText(textRenderer, text);
+                float textWidth = textMesh.GetWidth();
+                float textHeight = textMesh.GetHeight();
 
                 // Compute text positions
                 float textX = parent->x + x + (width - textWidth) / 2.0f;  // Center horizontally
                 float textY = parent->y + y + (height + textHeight) / 2.0f;  // Center vertically, adjust for baseline
 
-                textRenderer->RenderText(text, textX, textY, 1.0f, textColor);
+                textMesh.SetPosition(textX, textY);
+                textMesh.Draw(textColor, effects);
+            }
+        }
+
+        void setText(const std::string& newText) {
+            if (text != newText) {
+                text = newText;
+                markDirty();
             }
         }
 
@@ -493,6 +556,9 @@ void main()
             bool wasHovered = isHovered;
             isHovered = (mouseX > parent->x + x && mouseX < parent->x + x + width &&
                 mouseY > parent->y + y && mouseY < parent->y + y + height);
+            if (isHovered != wasHovered) {
+                markDirty();
+            }
 
             // Check for button click
             if (wasHovered && event->type == SDL_MOUSEBUTTONUP && event->button.button == SDL_BUTTON_LEFT) {
@@ -509,7 +575,8 @@ void main()
         }
 
         ~ButtonComponent() {
-            delete textRenderer;
+            TextRenderer::Release(textRenderer);
+            TextureCache::Release(texture);
         }
     };
 
@@ -534,12 +601,12 @@ void main()
 
         ListBoxComponent(const std::vector<std::string>& items, std::function<void(const std::string&)> onItemSelected = nullptr, int width = 100, int height = 150, int x = 0, int y = 0, float fontSize = 16.0f)
             : items(items), onItemSelected(onItemSelected), width(width), height(height), x(x), y(y), fontSize(fontSize) {
-            textRenderer = new TextRenderer(fontSize); // Initialize TextRenderer
+            textRenderer = TextRenderer::Acquire(fontSize); // Initialize TextRenderer
         }
 
         virtual void Draw() override {
-            if (!shaderProgram || !VAO) {
-                std::cerr << "Shader program or VAO not initialized." << std::endl;
+            if (!quadBatch.program) {
+                std::cerr << "Quad batch not initialized." << std::endl;
                 return;
             }
 
@@ -548,40 +615,14 @@ void main()
                 return;
             }
 
-            glUseProgram(shaderProgram);
-            glBindVertexArray(VAO);
-
-            GLint useTextureLoc = glGetUniformLocation(shaderProgram, "useTexture");
-            GLint fallbackColorLoc = glGetUniformLocation(shaderProgram, "fallbackColor");
-            GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-            GLint projLoc = glGetUniformLocation(shaderProgram, "projection");
-
-            if (useTextureLoc == -1 || fallbackColorLoc == -1 || modelLoc == -1 || projLoc == -1) {
-                std::cerr << "Failed to get uniform locations." << std::endl;
-                glBindVertexArray(0);
-                glUseProgram(0);
-                return;
-            }
-
             // Draw the border (black)
-            glUniform1i(useTextureLoc, 0); // Not using texture
-            glUniform4f(fallbackColorLoc, 0.0f, 0.0f, 0.0f, 1.0f); // Black border color
-
             // Calculate border dimensions
             float borderWidth = width + 4.0f; // Add 4 for 2 pixels border on each side
             float borderHeight = height + 4.0f;
-            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x - 2.0f, y - 2.0f, 0.0f));
-            model = glm::scale(model, glm::vec3(borderWidth, borderHeight, 1.0f));
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            submitQuad(x - 2.0f, y - 2.0f, borderWidth, borderHeight, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)); // Black border color
 
             // Draw the background (grey)
-            glUniform4f(fallbackColorLoc, 0.7f, 0.7f, 0.7f, 1.0f); // Grey background color
-            model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
-            model = glm::scale(model, glm::vec3(width, height, 1.0f));
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            submitQuad(x, y, width, height, glm::vec4(0.7f, 0.7f, 0.7f, 1.0f)); // Grey background color
 
             // Draw each item in the list
             float itemY = y - scrollPosition;
@@ -592,9 +633,10 @@ void main()
                     continue;
                 }
 
-                // Calculate the width and height of the text
-                float textWidth = textRenderer->GetTextWidth(items[i]);
-                float textHeight = textRenderer->GetTextHeight(items[i]);
+                // Calculate the width and height of the text, cached by the renderer
+                TextRenderer::TextExtents extents = textRenderer->Measure(items[i]);
+                float textWidth = extents.width;
+                float textHeight = extents.height;
 
                 // Center the text horizontally and vertically within the list box item
                 float textX = x + (width - textWidth) / 2.0f;
@@ -604,9 +646,6 @@ void main()
                 textRenderer->RenderText(items[i], textX, textY, 1.0f, textColor);
                 itemY += fontSize + 5.0f; // Adjust spacing between items
             }
-
-            glBindVertexArray(0);
-            glUseProgram(0);
         }
 
 
@@ -628,6 +667,7 @@ void main()
             if (event->type == SDL_MOUSEBUTTONUP && event->button.button == SDL_BUTTON_LEFT) {
                 if (hoveredItemIndex != -1) {
                     selectedItemIndex = hoveredItemIndex;
+                    markDirty();
                     if (onItemSelected) {
                         onItemSelected(items[selectedItemIndex]);
                     }
@@ -640,11 +680,12 @@ void main()
                 scrollPosition = std::max(0, scrollPosition - scrollAmount);
                 totalContentHeight = static_cast<int>(items.size() * (fontSize + 5));
                 scrollPosition = std::min(scrollPosition, totalContentHeight - height);
+                markDirty();
             }
         }
 
         ~ListBoxComponent() {
-            delete textRenderer;
+            TextRenderer::Release(textRenderer);
         }
     };
 
@@ -668,40 +709,13 @@ void main()
         virtual void Draw() override {
 
             //draw the checkbox box
-            glUseProgram(shaderProgram);
-            glBindVertexArray(VAO);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0); // Indicate not using texture
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.5f, 0.5f, 0.5f, 1.0f); // Example: Gray color
-
-            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
-            model = glm::scale(model, glm::vec3(width, height, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
-            glUseProgram(0);
+            submitQuad(x, y, width, height, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)); // Example: Gray color
 
             //draw the checkbox checkmark if the checkbox is checked
 
             if (isChecked) {
-                glUseProgram(shaderProgram);
-                glBindVertexArray(VAO);
-                glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0); // Indicate not using texture
-                glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 1.0f, 1.0f, 1.0f, 1.0f); // Example: White color
-
-                glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x + 5, y + 5, 0.0f));
-                model = glm::scale(model, glm::vec3(width - 10, height - 10, 1.0f));
-                glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-                glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-                glBindVertexArray(0);
-                glUseProgram(0);
+                submitQuad(x + 5, y + 5, width - 10, height - 10, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)); // Example: White color
             }
-
-
-
         }
 
         virtual void handleEvents(SDL_Event* event) override {
@@ -713,6 +727,7 @@ void main()
                 if (mouseX >= x && mouseX <= x + width && mouseY >= y && mouseY <= y + height) {
                     // Toggle the checkbox state
                     isChecked = !isChecked;
+                    markDirty();
 
                     // Call the onCheckedChanged callback if provided
                     if (onCheckedChanged) {
@@ -744,27 +759,11 @@ void main()
             : x(x), y(y), width(width), height(height), isComplete(isComplete), progress(initProgress) {}
 
         virtual void Draw() override {
-            glUseProgram(shaderProgram);
-            glBindVertexArray(VAO);
-
-            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0); // Not using texture
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.5f, 0.5f, 0.5f, 1.0f); // Background color
-
             // Draw background
-            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
-            model = glm::scale(model, glm::vec3(width, height, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            submitQuad(x, y, width, height, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)); // Background color
 
             // Draw filled portion
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.0f, 0.7f, 0.0f, 1.0f); // Filled color
-            model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
-            model = glm::scale(model, glm::vec3(width * progress, height, 1.0f)); // Scale based on progress
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-            glBindVertexArray(0);
-            glUseProgram(0);
+            submitQuad(x, y, width * progress, height, glm::vec4(0.0f, 0.7f, 0.0f, 1.0f)); // Scale based on progress
         }
 
         virtual void handleEvents(SDL_Event* event) override {
@@ -791,7 +790,11 @@ void main()
         }
 
         void setProgress(float newProgress) {
-            progress = std::clamp(newProgress, 0.0f, 1.0f); // Ensure progress is between 0.0 and 1.0
+            float clamped = std::clamp(newProgress, 0.0f, 1.0f); // Ensure progress is between 0.0 and 1.0
+            if (clamped != progress) {
+                progress = clamped;
+                markDirty();
+            }
             if (progress >= 1.0f && isComplete) {
                 isComplete(true); // Call the completion callback if progress is complete
             }
@@ -822,13 +825,17 @@ void main()
 
         int selectionStart = -1, selectionEnd = -1;
         bool isSelecting = false;
-        float fontSize;
+        float fontSize = 16.0f; // Also the key into the shared font registry, so never leave it unset
         TextBoxComponent(int x, int y, int width, int height, std::function<void(const std::string&)> onTextChanged, const std::string& text = "", float transparency = 1.0f)
             : x(x), y(y), width(width), height(height), onTextChanged(onTextChanged), text(text), transparency(transparency) {
             textComponent = new TextComponent(text, fontSize,x, y);
             maxCharsPerLine = width / 28;
         }
 
+        ~TextBoxComponent() {
+            delete textComponent; // Releases its shared TextRenderer
+        }
+
         std::string wrapText(const std::string& text, int maxCharsPerLine) {
             std::string wrappedText;
             int lineLength = 0;
@@ -845,20 +852,8 @@ void main()
 
         virtual void Draw() override {
             // Draw the text box background
-            glUseProgram(shaderProgram);
-            glBindVertexArray(VAO);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0); // Indicate not using texture
             // Use transparency when setting the background color
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.5f, 0.5f, 0.5f, transparency); // Use transparency here
-
-            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
-            model = glm::scale(model, glm::vec3(width, height, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
-            glUseProgram(0);
+            submitQuad(x, y, width, height, glm::vec4(0.5f, 0.5f, 0.5f, transparency)); // Use transparency here
 
             // Update the text component with the wrapped text
             textComponent->text = wrapText(text, maxCharsPerLine);
@@ -866,11 +861,9 @@ void main()
             textComponent->x = x + 5;
             textComponent->y = y + 5 - scrollPosition;
             // Enable scissor test for clipping
-            glEnable(GL_SCISSOR_TEST);
-            int scissorY = SCREEN_HEIGHT - (y + height);
-            glScissor(x, scissorY, width, height);
+            beginScissor(x, y, width, height);
             textComponent->Draw();
-            glDisable(GL_SCISSOR_TEST);
+            endScissor();
 
             // Calculate if scrolling is needed
             totalTextHeight = static_cast<int>((textComponent->text.length() / maxCharsPerLine + 1) * lineHeight);
@@ -881,37 +874,16 @@ void main()
                 // Calculate the scroll bar position based on the scroll position
                 float scrollBarY = y + (scrollPosition / static_cast<float>(totalTextHeight)) * height;
                 // Draw the scroll bar
-                glUseProgram(shaderProgram);
-                glBindVertexArray(VAO);
-                glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0); // Indicate not using texture
-                glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 1.5f, 0.5f, 0.5f, 1.0f); // Gray color
-                glm::mat4 scrollBarModel = glm::translate(glm::mat4(1.0f), glm::vec3(x + width - 10.0f, scrollBarY, 0.0f));
-                scrollBarModel = glm::scale(scrollBarModel, glm::vec3(10.0f, scrollBarHeight, 1.0f));
-                glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(scrollBarModel));
-                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-                glBindVertexArray(0);
-                glUseProgram(0);
+                submitQuad(x + width - 10.0f, scrollBarY, 10.0f, scrollBarHeight, glm::vec4(1.5f, 0.5f, 0.5f, 1.0f)); // Gray color
             }
 
             // Draw the cursor when the box is in focus
             if (isFocused) {
-                glUseProgram(shaderProgram);
-                glBindVertexArray(VAO);
-                glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0); // Indicate not using texture
-                glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 1.0f, 1.0f, 1.0f, 1.0f); // Example: White color
-
                 // Calculate cursor position based on text length
                 int cursorPos = (text.length() % maxCharsPerLine) * 10 + 10; // Assuming each character is approx 10 pixels wide
                 int cursorYOffset = (text.length() / maxCharsPerLine) * lineHeight;
 
-                glm::mat4 cursorModel = glm::translate(glm::mat4(1.0f), glm::vec3(x + cursorPos, y + 5 + cursorYOffset - scrollPosition, 0.0f));
-                cursorModel = glm::scale(cursorModel, glm::vec3(2, lineHeight - 10, 1.0f));
-                glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(cursorModel));
-                glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-                glBindVertexArray(0);
-                glUseProgram(0);
+                submitQuad(x + cursorPos, y + 5 + cursorYOffset - scrollPosition, 2, lineHeight - 10, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)); // Example: White color
 
                 if (isSelecting || (selectionStart != -1 && selectionEnd != -1)) {
                     // Draw highlight background for selected text
@@ -927,17 +899,7 @@ void main()
                         int highlightY = y + line * lineHeight + 5 - scrollPosition;
                         int highlightHeight = lineHeight;
 
-                        glUseProgram(shaderProgram);
-                        glBindVertexArray(VAO);
-                        glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0); // Indicate not using texture
-                        glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.0f, 0.0f, 1.0f, 0.5f); // Blue color with 50% transparency
-                        glm::mat4 highlightModel = glm::translate(glm::mat4(1.0f), glm::vec3(highlightX, highlightY, 0.0f));
-                        highlightModel = glm::scale(highlightModel, glm::vec3(highlightWidth, highlightHeight, 1.0f));
-                        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(highlightModel));
-                        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-                        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-                        glBindVertexArray(0);
-                        glUseProgram(0);
+                        submitQuad(highlightX, highlightY, highlightWidth, highlightHeight, glm::vec4(0.0f, 0.0f, 1.0f, 0.5f)); // Blue color with 50% transparency
                     }
                 }
             }
@@ -945,6 +907,7 @@ void main()
 
         virtual void handleEvents(SDL_Event* event) override {
             if (event->type == SDL_TEXTINPUT && isFocused) {
+                markDirty();
                 if (isSelecting && selectionStart != selectionEnd) {
                     deleteSelectedText();
                 }
@@ -957,6 +920,7 @@ void main()
                 }
             }
             else if (event->type == SDL_KEYDOWN && isFocused) {
+                markDirty();
                 if (event->key.keysym.sym == SDLK_BACKSPACE && !text.empty()) {
                     if (isSelecting && selectionStart != selectionEnd) {
                         deleteSelectedText();
@@ -1010,10 +974,14 @@ void main()
                 if (mouseX > x && mouseX < x + width && mouseY > y && mouseY < y + height) {
                     isFocused = true;
                     isSelecting = true;
+                    markDirty();
                     selectionStart = calculateTextIndexAtPosition(event->button.x, event->button.y);
                     selectionEnd = selectionStart;
                 }
                 else {
+                    if (isFocused) {
+                        markDirty(); // Losing focus hides the cursor
+                    }
                     isFocused = false;
                     isSelecting = false;
                     selectionStart = selectionEnd = -1;
@@ -1023,9 +991,11 @@ void main()
                 isSelecting = false;
             }
             else if (event->type == SDL_MOUSEMOTION && isSelecting) {
+                markDirty();
                 selectionEnd = calculateTextIndexAtPosition(event->motion.x, event->motion.y);
             }
             else if (event->type == SDL_MOUSEWHEEL && isFocused) {
+                markDirty();
                 scrollPosition += event->wheel.y * scrollSpeed;
                 scrollPosition = std::max(0, std::min(scrollPosition, totalTextHeight - height));
             }
@@ -1090,25 +1060,12 @@ void main()
 
         TextInputBoxComponent(int x, int y, int width, int height, std::function<void(const std::string&)> onTextChanged, const std::string& text = "", int options = 0)
             : x(x), y(y), width(width), height(height), onTextChanged(onTextChanged), text(text), options(options), fontSize(24.0f) { // Initialize fontSize
-            textRenderer = new TextRenderer(fontSize); // Initialize TextRenderer
+            textRenderer = TextRenderer::Acquire(fontSize); // Initialize TextRenderer
         }
 
         virtual void Draw() override {
             // Draw the box for the input box
-            glUseProgram(shaderProgram);
-            glBindVertexArray(VAO);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0); // Indicate not using texture
-
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.5f, 0.5f, 0.5f, 1.0f); // Example: Gray color
-
-            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
-            model = glm::scale(model, glm::vec3(width, height, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
-            glUseProgram(0);
+            submitQuad(x, y, width, height, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)); // Example: Gray color
 
             // Render the text using TextRenderer
             std::string displayText = text;
@@ -1124,10 +1081,14 @@ void main()
                     event->button.y >= y && event->button.y <= y + height) {
                     isFocused = true;
                     isSelecting = true;
+                    markDirty();
                     selectionStart = calculateTextIndexAtPosition(event->button.x, event->button.y);
                     selectionEnd = selectionStart;
                 }
                 else {
+                    if (isFocused) {
+                        markDirty(); // Losing focus hides the cursor
+                    }
                     isFocused = false;
                     isSelecting = false;
                     selectionStart = selectionEnd = -1;
@@ -1137,18 +1098,22 @@ void main()
                 isSelecting = false;
             }
             else if (event->type == SDL_MOUSEMOTION && isSelecting) {
+                markDirty();
                 selectionEnd = calculateTextIndexAtPosition(event->motion.x, event->motion.y);
             }
             else if (event->type == SDL_MOUSEWHEEL && isFocused) {
+                markDirty();
                 scrollPosition += event->wheel.y * scrollSpeed;
                 scrollPosition = std::max(0, std::min(scrollPosition, totalTextHeight - height));
             }
             else if (event->type == SDL_TEXTINPUT && isFocused) {
+                markDirty();
                 text.insert(selectionEnd, event->text.text);
                 selectionEnd += strlen(event->text.text);
                 onTextChanged(text);
             }
             else if (event->type == SDL_KEYDOWN && isFocused) {
+                markDirty();
                 if (event->key.keysym.sym == SDLK_BACKSPACE && selectionEnd > 0) {
                     text.erase(selectionEnd - 1, 1);
                     selectionEnd--;
@@ -1188,6 +1153,10 @@ void main()
             x += deltaX;
             y += deltaY;
         }
+
+        ~TextInputBoxComponent() {
+            TextRenderer::Release(textRenderer);
+        }
     };
 
 
@@ -1196,53 +1165,27 @@ void main()
     ///////////////////////////////////////////IMAGE COMPONENT////////////////////////////////////////////////////////////
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     struct ImageComponent : public UIComponent {
-        GLuint texture = 0; // Initialize texture
+        Texture* texture = nullptr; // Shared through TextureCache
 
         ImageComponent(int x, int y, int width, int height, const std::string& imagePath)
-            : UIComponent(), texture(0) { // Ensure texture is initialized
+            : UIComponent() {
             this->x = x;
             this->y = y;
             this->width = width;
             this->height = height;
 
             // Load the image
-            SDL_Surface* surface = IMG_Load(imagePath.c_str());
-            if (surface) {
-                glGenTextures(1, &texture);
-                glBindTexture(GL_TEXTURE_2D, texture);
-
-                GLenum format = surface->format->BytesPerPixel == 4 ? GL_RGBA : GL_RGB;
-                glTexImage2D(GL_TEXTURE_2D, 0, format, surface->w, surface->h, 0, format, GL_UNSIGNED_BYTE, surface->pixels);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-                SDL_FreeSurface(surface);
-            }
-            else {
-                std::cerr << "Failed to load image " << IMG_GetError() << std::endl;
-            }
+            // Decoded at the size it is shown, the FileBrowser icon stays 16x16 whatever the source
+            texture = TextureCache::Acquire(imagePath, TEXTURE_ASYNC, width, height);
         }
 
         virtual void Draw() override {
-            glUseProgram(shaderProgram);
-            glBindVertexArray(VAO);
-
-            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 1); // Indicate using texture
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 1.0f, 1.0f, 1.0f, 1.0f); // White color
-
-            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
-            model = glm::scale(model, glm::vec3(width, height, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-            glBindVertexArray(0);
-            glUseProgram(0);
+            if (texture && texture->resident) {
+                submitQuad(x, y, width, height, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), texture->id, texture->uv); // White color
+            }
+            else if (texture) {
+                submitQuad(x, y, width, height, TextureCache::placeholderColor); // Still loading
+            }
         }
 
         virtual void handleEvents(SDL_Event* event) override {
@@ -1255,9 +1198,7 @@ void main()
             y += deltaY;
         }
         ~ImageComponent() {
-            if (texture) {
-                glDeleteTextures(1, &texture);
-            }
+            TextureCache::Release(texture);
         }
     };
 
@@ -1267,74 +1208,62 @@ void main()
     struct animatedImage : public UIComponent {
         int x, y;
         int width, height;
-        int frameWidth, frameHeight; // Size of each frame
+        int frameWidth = 0, frameHeight = 0; // Size of each frame
         int frames; // Total number of frames in the sprite sheet
         int keyFrame = 0;
         int currentFrame = 0; // Current frame to display
-        GLuint texture;
+        Texture* texture = nullptr;
         float frameDuration; // Duration of each frame in seconds
-        float elapsedTime = 0.0f; // Time elapsed since the last frame change
-        float deltaTime = 0.0f;
+        Uint32 startTicks = SDL_GetTicks(); // Frames are derived from the clock, not from how often we draw
 
         animatedImage(int x, int y, int width, int height, const std::string& imagePath, int frames, float frameDuration)
             : x(x), y(y), width(width), height(height), frames(frames), frameDuration(frameDuration) {
-            SDL_Surface* surface = IMG_Load(imagePath.c_str());
-            if (surface) {
-                glGenTextures(1, &texture);
-                glBindTexture(GL_TEXTURE_2D, texture);
-
-                GLenum format;
-                if (surface->format->BytesPerPixel == 4) {
-                    format = GL_RGBA;
-                }
-                else {
-                    format = GL_RGB;
-                }
+            texture = TextureCache::Acquire(imagePath, TEXTURE_ASYNC);
+        }
 
-                glTexImage2D(GL_TEXTURE_2D, 0, format, surface->w, surface->h, 0, format, GL_UNSIGNED_BYTE, surface->pixels);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        ~animatedImage() {
+            TextureCache::Release(texture);
+        }
 
-                frameWidth = surface->w / frames; // Assuming all frames are evenly spaced in the sprite sheet
-                frameHeight = surface->h;
+        Uint32 frameMilliseconds() const {
+            return std::max<Uint32>(static_cast<Uint32>(frameDuration * 1000.0f), 1);
+        }
 
-                SDL_FreeSurface(surface);
-            }
-            else {
-                std::cerr << "Failed to load texture: " << IMG_GetError() << std::endl;
-            }
+        int frameAt(Uint32 ticks) const {
+            return static_cast<int>(((ticks - startTicks) / frameMilliseconds()) % frames);
         }
 
         virtual void Draw() override {
-            elapsedTime += deltaTime;
-            if (elapsedTime >= frameDuration) {
-                currentFrame = (currentFrame + 1) % frames;
-                elapsedTime = 0.0f;
+            if (!texture || frames <= 0) {
+                return;
             }
+            if (!texture->resident) {
+                submitQuad(x, y, width, height, TextureCache::placeholderColor); // Still loading
+                return;
+            }
+            // Frame size is only known once the sheet has loaded
+            frameWidth = texture->width / frames; // Assuming all frames are evenly spaced in the sprite sheet
+            frameHeight = texture->height;
+            currentFrame = frameAt(SDL_GetTicks());
 
-            // Calculate the texture offset for the current frame
-            float texOffset = (float)currentFrame / (float)frames;
-
-            // Bind the texture
-            glUseProgram(shaderProgram);
-            glBindVertexArray(VAO);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 1); // Indicate using texture
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-
-            // Pass the texOffset to the shader
-            glUniform1f(glGetUniformLocation(shaderProgram, "texOffset"), texOffset);
-
-            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
-            model = glm::scale(model, glm::vec3(frameWidth, frameHeight, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+            // Calculate the texture offset for the current frame, within the texture's own sub-rect
+            float frameSpan = (texture->uv.z - texture->uv.x) / (float)frames;
+            float texOffset = texture->uv.x + frameSpan * (float)currentFrame;
 
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            // Select the current frame's slice of the sprite sheet through the UVs
+            submitQuad(x, y, frameWidth, frameHeight, glm::vec4(1.0f), texture->id, glm::vec4(texOffset, texture->uv.y, texOffset + frameSpan, texture->uv.w));
+        }
 
-            glBindVertexArray(0);
-            glUseProgram(0);
+        virtual int animationDelay() const override {
+            if (frames <= 1) {
+                return -1;
+            }
+            Uint32 now = SDL_GetTicks();
+            if (frameAt(now) != currentFrame) {
+                return 0;
+            }
+            Uint32 frameMs = frameMilliseconds();
+            return static_cast<int>(frameMs - (now - startTicks) % frameMs);
         }
 
         virtual void handleEvents(SDL_Event* event) override {
@@ -1367,34 +1296,25 @@ void main()
         std::string text;
         std::function<void()> onClick;
         TextComponent* textComponent = nullptr;
-        float fontSize;
+        float fontSize = 16.0f;
         Tab(int x, int y, int width, int height, const std::string& text, std::function<void()> onClick)
             : x(x), y(y), width(width), height(height), text(text), onClick(onClick) {
             textComponent = new TextComponent(text, fontSize,x, y);
         }
 
+        ~Tab() {
+            delete textComponent;
+        }
+
         virtual void Draw() override {
             // Draw the tab background
-            glUseProgram(shaderProgram);
-            glBindVertexArray(VAO);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0); // Indicate not using texture
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.5f, 0.5f, 0.5f, 1.0f); // Example: Gray color
+            glm::vec4 tabColor(0.5f, 0.5f, 0.5f, 1.0f); // Example: Gray color
 
             // Render a border around the tab
-            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x - 2, y - 2, 0.0f));
-            model = glm::scale(model, glm::vec3(width + 4, height + 4, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            submitQuad(x - 2, y - 2, width + 4, height + 4, tabColor);
 
             // Draw the tab itself
-            model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f)); // Modify the existing 'model' variable
-            model = glm::scale(model, glm::vec3(width, height, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            submitQuad(x, y, width, height, tabColor);
 
             //draw the text on the tab
 
@@ -1403,9 +1323,6 @@ void main()
                 textComponent->y = this->y;
                 textComponent->Draw();
             }
-
-            glBindVertexArray(0);
-            glUseProgram(0);
         }
 
         virtual void handleEvents(SDL_Event* event) override {
@@ -1453,18 +1370,23 @@ void main()
         FileBrowser(int x, int y, int width, int height, const std::string& currentPath, float fontSize, std::function<void(const std::string&)> onFileSelected)
             : x(x), y(y), width(width), height(height), currentPath(currentPath), fontSize(fontSize), onFileSelected(onFileSelected) {
             textComponent = new TextComponent(currentPath, fontSize, x, y);
-            textRenderer = new TextRenderer(fontSize);
+            textRenderer = TextRenderer::Acquire(fontSize);
             directoryIcon = new ImageComponent(0, 0, 16, 16, "UI/directory.png"); // Load the directory icon
             updateDirectoryList();
             updateFileList(); // Initialize file list (empty at start)
         }
 
         ~FileBrowser() {
-            delete textRenderer;
+            TextRenderer::Release(textRenderer);
             delete textComponent;
             delete directoryIcon; // Clean up the directory icon
         }
 
+        // Height of one directory or file row, from the face's line height plus spacing
+        int rowHeight() const {
+            return static_cast<int>(textRenderer->GetLineHeight()) + 5;
+        }
+
         void updateDirectoryList() {
             directories.clear();
             if (!currentPath.empty()) {
@@ -1496,55 +1418,25 @@ void main()
         }
 
         virtual void Draw() override {
-            // Use the shader program
-            glUseProgram(shaderProgram);
-            glBindVertexArray(VAO);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0); // Not using texture
-
             // Render the border (e.g., light gray)
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.9f, 0.9f, 0.9f, 1.0f);
-            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x - 1, y - 1, 0.0f));
-            model = glm::scale(model, glm::vec3(width + 2, height + 2, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            submitQuad(x - 1, y - 1, width + 2, height + 2, glm::vec4(0.9f, 0.9f, 0.9f, 1.0f));
 
             // Render the main background (e.g., white or very light gray)
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.97f, 0.97f, 0.97f, 1.0f);
-            model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
-            model = glm::scale(model, glm::vec3(width, height, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            submitQuad(x, y, width, height, glm::vec4(0.97f, 0.97f, 0.97f, 1.0f));
 
             // Render the sidebar (e.g., light blue or gray) - Static directory list
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.85f, 0.85f, 0.90f, 1.0f);
-            model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
-            model = glm::scale(model, glm::vec3(width / 4, height, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            submitQuad(x, y, width / 4, height, glm::vec4(0.85f, 0.85f, 0.90f, 1.0f));
 
             // Render the main file list area (e.g., slightly darker than background)
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.94f, 0.94f, 0.94f, 1.0f);
-            model = glm::translate(glm::mat4(1.0f), glm::vec3(x + width / 4, y, 0.0f));
-            model = glm::scale(model, glm::vec3(width * 3 / 4, height, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            submitQuad(x + width / 4, y, width * 3 / 4, height, glm::vec4(0.94f, 0.94f, 0.94f, 1.0f));
 
             // Render the header/toolbar (e.g., dark gray)
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.6f, 0.6f, 0.6f, 1.0f);
-            model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y + height - 20, 0.0f)); // Assuming header height of 20
-            model = glm::scale(model, glm::vec3(width, 20, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            submitQuad(x, y + height - 20, width, 20, glm::vec4(0.6f, 0.6f, 0.6f, 1.0f)); // Assuming header height of 20
 
             // Render the text in the sidebar (directory list)
             float textX = x + 10; // Adjust as needed
             float textY = y + 30 - sidebarScrollOffset; // Adjust initial position with scrollOffset
-            int textHeight = textRenderer->GetTextHeight("A") + 5; // Calculate text height including spacing
+            int textHeight = rowHeight(); // Text height including spacing
             int iconSize = 16; // Assuming icon size is 16x16
             for (const auto& directory : directories) {
                 
@@ -1582,9 +1474,6 @@ void main()
                     textY += textHeight; // Adjust spacing as needed
                 }
             }
-
-            glBindVertexArray(0);
-            glUseProgram(0);
         }
         virtual void handleEvents(SDL_Event* event) override {
             if (event->type == SDL_MOUSEBUTTONDOWN) {
@@ -1595,7 +1484,7 @@ void main()
 
                 // Check if clicked in the sidebar
                 if (mouseX > x && mouseX < x + width / 4 && mouseY > y && mouseY < y + height) {
-                    int directoryIndex = (mouseY - y + sidebarScrollOffset) / (textRenderer->GetTextHeight("A") + 5);
+                    int directoryIndex = (mouseY - y + sidebarScrollOffset) / rowHeight();
                  
                     if (directoryIndex >= 0 && directoryIndex < directories.size()) {
                         std::string selectedDir = directories[directoryIndex];
@@ -1604,6 +1493,7 @@ void main()
                         try {
                             if (std::filesystem::exists(fullPath) && std::filesystem::is_directory(fullPath)) {
                                 selectedDirectory = fullPath;
+                                markDirty();
                                 textComponent->text = selectedDirectory;
                                 if (onFileSelected) {
                                     onFileSelected(selectedDirectory);
@@ -1644,16 +1534,18 @@ void main()
             if (event->type == SDL_MOUSEWHEEL) {
                 if (isMouseOverSidebar) {
                     sidebarScrollOffset -= event->wheel.y * 20;
+                    markDirty();
                     if (sidebarScrollOffset < 0) sidebarScrollOffset = 0;
-                    int maxScroll = std::max(0, static_cast<int>(directories.size() * (textRenderer->GetTextHeight("A") + 5) - height));
+                    int maxScroll = std::max(0, static_cast<int>(directories.size() * rowHeight() - height));
                     if (sidebarScrollOffset > maxScroll) sidebarScrollOffset = maxScroll;
                    
                 }
 
                 if (isMouseOverFileList) {
                     fileListScrollOffset -= event->wheel.y * 20;
+                    markDirty();
                     if (fileListScrollOffset < 0) fileListScrollOffset = 0;
-                    int maxScroll = std::max(0, static_cast<int>(files.size() * (textRenderer->GetTextHeight("A") + 5) - height));
+                    int maxScroll = std::max(0, static_cast<int>(files.size() * rowHeight() - height));
                     if (fileListScrollOffset > maxScroll) fileListScrollOffset = maxScroll;
                  
                 }
@@ -1678,6 +1570,8 @@ void main()
         TextRenderer* textRenderer = nullptr;
         float fontSize;
         glm::vec3 textColor;
+        TextEffects effects;
+        TextMesh textMesh;
 
         LabelComponent(int x, int y, const std::string& text, float fontSize, int width, int height, glm::vec3 textColor = glm::vec3(1.0f, 0.0f, 1.0f))
             : text(text), fontSize(fontSize), textColor(textColor) {
@@ -1685,7 +1579,7 @@ void main()
             this->y = y;
             this->width = width;
             this->height = height;
-            textRenderer = new TextRenderer(fontSize);
+            textRenderer = TextRenderer::Acquire(fontSize);
         }
 
         virtual void Draw() override {
@@ -1694,30 +1588,26 @@ void main()
                 return;
             }
 
-            glUseProgram(shaderProgram);
-            glBindVertexArray(VAO);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0);
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 0.9f, 0.9f, 0.9f, 1.0f);
-
-            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
-            model = glm::scale(model, glm::vec3(width, height, 1.0f));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            submitQuad(x, y, width, height, glm::vec4(0.9f, 0.9f, 0.9f, 1.0f));
 
             if (textRenderer) {
-                float textWidth = textRenderer->GetTextWidth(text);
-                float textHeight = textRenderer->GetTextHeight(text);
+                textMesh.SetText(textRenderer, text);
+                float textWidth = textMesh.GetWidth();
+                float textHeight = textMesh.GetHeight();
 
+                // Label() already offsets x and y by the widget position
                 float textX = x + (width - textWidth) / 2.0f;
                 float textY = y + (height + textHeight) / 2.0f;
 
-                if (parent) {
-                    textX += parent->x;
-                    textY += parent->y;
-                }
+                textMesh.SetPosition(textX, textY);
+                textMesh.Draw(textColor, effects);
+            }
+        }
 
-                textRenderer->RenderText(text, textX, textY, 1.0f, textColor);
+        void setText(const std::string& newText) {
+            if (text != newText) {
+                text = newText;
+                markDirty();
             }
         }
 
@@ -1730,75 +1620,44 @@ void main()
             y += deltaY;
         }
         ~LabelComponent() {
-            delete textRenderer;
+            TextRenderer::Release(textRenderer);
         }
     };
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     //////////////////////////////////////////////////////////TILED BACKGROUND FOR WIDGET///////////////////////////////////////////////////
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // One quad with repeating UVs, so any size costs a single quad in the batch
+    // and partial tiles at the right and bottom edges are clipped, not dropped.
     struct TiledBG : public UIComponent {
 		int startingX, startingY;
 		int tileWidth, tileHeight;
-		int numTilesX, numTilesY;
-		GLuint texture = 0;
+		Texture* texture = nullptr;
 
         TiledBG(int x, int y, int width, int height, int tileWidth, int tileHeight, const std::string& texturePath)
-            : startingX(x), startingY(y), tileWidth(tileWidth), tileHeight(tileHeight) {
+            : startingX(x), startingY(y), tileWidth(std::max(tileWidth, 1)), tileHeight(std::max(tileHeight, 1)) {
             this->width = width;
             this->height = height;
 
-            SDL_Surface* surface = IMG_Load(texturePath.c_str());
-            if (surface) {
-                glGenTextures(1, &texture);
-                glBindTexture(GL_TEXTURE_2D, texture);
-
-                GLenum format;
-                if (surface->format->BytesPerPixel == 4) {
-                    format = GL_RGBA;
-                }
-                else {
-                    format = GL_RGB;
-                }
-
-                glTexImage2D(GL_TEXTURE_2D, 0, format, surface->w, surface->h, 0, format, GL_UNSIGNED_BYTE, surface->pixels);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-                numTilesX = width / tileWidth;
-                numTilesY = height / tileHeight;
-
-                SDL_FreeSurface(surface);
+            texture = TextureCache::Acquire(texturePath, TEXTURE_REPEAT | TEXTURE_ASYNC, this->tileWidth, this->tileHeight);
+        }
 
-            }
-            else {
-                std::cerr << "Failed to load texture: " << IMG_GetError() << std::endl;
-            }
+        ~TiledBG() {
+            TextureCache::Release(texture);
         }
 
 		virtual void Draw() override {
-			glUseProgram(shaderProgram);
-			glBindVertexArray(VAO);
-
-			glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 1); // Indicate using texture
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, texture);
-			glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-
-			glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), 1.0f, 1.0f, 1.0f, 1.0f); // White color
-
-			for (int i = 0; i < numTilesX; i++) {
-				for (int j = 0; j < numTilesY; j++) {
-					glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(startingX + i * tileWidth, startingY + j * tileHeight, 0.0f));
-					model = glm::scale(model, glm::vec3(tileWidth, tileHeight, 1.0f));
-					glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-					glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-					glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-				}
+			if (!texture) {
+				return;
 			}
-
-			glBindVertexArray(0);
-			glUseProgram(0);
+			if (!texture->resident) {
+				submitQuad(startingX, startingY, width, height, TextureCache::placeholderColor); // Still loading
+				return;
+			}
+			// One tile per unit of UV, the sampler wraps the rest
+			float repeatX = static_cast<float>(width) / static_cast<float>(tileWidth);
+			float repeatY = static_cast<float>(height) / static_cast<float>(tileHeight);
+			submitQuad(startingX, startingY, width, height, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), texture->id, glm::vec4(0.0f, 0.0f, repeatX, repeatY));
 		}
 
         virtual void handleEvents(SDL_Event* event) override {
@@ -1819,31 +1678,15 @@ void main()
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // Functions for Widget
     void drawWidget(const Widget& widget) {
-        glUseProgram(shaderProgram);
-
-        // Set up transformation and projection matrices
-        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(widget.x, widget.y, 0.0f));
-        model = glm::scale(model, glm::vec3(widget.width, widget.height, 1.0f));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-        // Bind texture if available
-        int useTextureUniform = glGetUniformLocation(shaderProgram, "useTexture");
-        if (widget.texture) {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, widget.texture);
-            glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-            glUniform1i(useTextureUniform, 1);
+        // Draw the widget's base rectangle, textured if available
+        // Until the texture is resident the widget color stands in for it
+        if (widget.texture && widget.texture->resident) {
+            submitQuad(widget.x, widget.y, widget.width, widget.height, glm::vec4(1.0f), widget.texture->id, widget.texture->uv);
         }
         else {
-            glUniform1i(useTextureUniform, 0);
-            glUniform4f(glGetUniformLocation(shaderProgram, "fallbackColor"), widget.color.r, widget.color.g, widget.color.b, widget.color.a);
+            submitQuad(widget.x, widget.y, widget.width, widget.height, widget.color);
         }
 
-        // Draw the widget's base rectangle
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
         //draw each component after the widget
         for (auto component : widget.components) {
             component->Draw();
@@ -1853,15 +1696,85 @@ void main()
         if (widget.textComponent) {
             widget.textComponent->Draw();
         }
+    }
+
+
+
+
+
+    // Whether drawCachedWidget() is going to re-render the widget
+    bool cacheIsStale(const Widget& widget) {
+        return widget.isDirty || !widget.cache.fbo ||
+            widget.cache.width != std::max(widget.width, 1) || widget.cache.height != std::max(widget.height, 1);
+    }
+
+    // Re-render the widget into its texture only when something changed, then
+    // composite the texture. Content outside the widget rect is clipped.
+    // recorded holds the widget's commands when they were recorded on a worker.
+    void drawCachedWidget(Widget& widget, DrawList* recorded = nullptr) {
+        if (resizeRenderTarget(widget.cache, widget.width, widget.height) || widget.isDirty) {
+            beginRenderTarget(widget.cache, widget.x, widget.y);
+            if (recorded) {
+                appendDrawList(*recorded);
+            }
+            else {
+                drawWidget(widget);
+            }
+            endRenderTarget();
+            widget.isDirty = false;
+            renderStats.widgetsRendered++;
+        }
+        else {
+            renderStats.widgetsFromCache++;
+        }
+
+        compositeRenderTarget(widget.cache, static_cast<float>(widget.x), static_cast<float>(widget.y));
+    }
+
+    // When on, uncached widgets are recorded once and drawn from their retained
+    // list until marked dirty. Off by default: fields changed directly, such as
+    // label->text, only show up after markWidgetDirty() while it is on.
+    bool retainWidgets = false;
 
-       
-        glBindVertexArray(0);
-        glUseProgram(0);
+    void setRetainWidgets(bool enabled) {
+        retainWidgets = enabled;
     }
 
+    // Whether drawRetainedWidget() has to record the widget again
+    bool retainedIsStale(const Widget& widget) {
+        return widget.isDirty || !widget.retained.valid || widget.retained.glyphGeneration != glyphAtlasGeneration;
+    }
 
+    DrawList retainScratch; // Widgets recorded on the GL thread before they are retained
 
+    // Records the widget only when it changed, otherwise reuses its retained
+    // list. A drag just moves the retained list, rewriting its own instance slice.
+    // recorded holds the widget's commands when they were recorded on a worker.
+    void drawRetainedWidget(Widget& widget, DrawList* recorded = nullptr) {
+        if (retainedIsStale(widget)) {
+            if (!recorded) {
+                recordingList = &retainScratch;
+                drawWidget(widget);
+                recordingList = nullptr;
+                recorded = &retainScratch;
+            }
+            retainDrawList(widget.retained, *recorded, widget.x, widget.y);
+            widget.isDirty = false;
+        }
+        else {
+            moveRetainedList(widget.retained, widget.x, widget.y);
+        }
+        appendRetainedList(widget.retained);
+    }
 
+    // For state changed outside the component API, such as assigning text directly
+    void markWidgetDirty(int ID) {
+        for (auto widget : uiManager.widgets) {
+            if (widget->ID == ID) {
+                widget->markDirty();
+            }
+        }
+    }
 
     void handleWidgetEvents(Widget& widget, SDL_Event* event) {
         for (auto component : widget.components) {
@@ -1902,30 +1815,10 @@ void main()
             widget->y = y;
             widget->width = width;
             widget->height = height;
-            widget->texture = 0;
-
-            SDL_Surface* surface = IMG_Load(texturePath.c_str());
-            if (surface) {
-                glGenTextures(1, &widget->texture);
-                glBindTexture(GL_TEXTURE_2D, widget->texture);
-
-                GLenum format;
-                if (surface->format->BytesPerPixel == 4) {
-                    format = GL_RGBA;
-                }
-                else {
-                    format = GL_RGB;
-                }
-
-                glTexImage2D(GL_TEXTURE_2D, 0, format, surface->w, surface->h, 0, format, GL_UNSIGNED_BYTE, surface->pixels);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                SDL_FreeSurface(surface);
+            // An empty or missing texture falls back to the widget color
+            widget->texture = TextureCache::Acquire(texturePath, TEXTURE_ASYNC, width, height);
 
-            }
-            else {
-                std::cerr << "Failed to load texture: " << IMG_GetError() << std::endl;
-            }
+            widget->isCached = hasFlag(options, WIDGET_CACHED);
 
             if (hasFlag(options, WIDGET_DRAGGABLE)) {
                 widget->draggableComponent = new DraggableComponent();
@@ -1934,6 +1827,7 @@ void main()
 
             uiManager.widgets.push_back(widget);
             uiManager.currentWidget = widget;
+            uiManager.damageWidget(*widget);
         }
 
 
@@ -1996,6 +1890,7 @@ void main()
         checkBoxComponent->height = 20;
 
         // Add the CheckBoxComponent to the current widget's components for it to be drawn and interacted with
+        checkBoxComponent->parent = uiManager.currentWidget;
         uiManager.currentWidget->components.push_back(checkBoxComponent);
     }
 
@@ -2013,6 +1908,7 @@ void main()
         progressBarComponent->height = height;
 
         // Add the ProgressBarComponent to the current widget's components for it to be drawn and interacted with
+        progressBarComponent->parent = uiManager.currentWidget;
         uiManager.currentWidget->components.push_back(progressBarComponent);
     }
 
@@ -2031,6 +1927,7 @@ void main()
         textBoxComponent->height = height;
 
         // Add the TextBoxComponent to the current widget's components for it to be drawn and interacted with
+        textBoxComponent->parent = uiManager.currentWidget;
         uiManager.currentWidget->components.push_back(textBoxComponent);
     }
 
@@ -2048,6 +1945,7 @@ void main()
         textInputBoxComponent->height = height;
 
         // Add the TextInputBox to the current widget's components for it to be drawn and interacted with
+        textInputBoxComponent->parent = uiManager.currentWidget;
         uiManager.currentWidget->components.push_back(textInputBoxComponent);
     }
 
@@ -2066,6 +1964,7 @@ void main()
         imageComponent->height = height;
 
         // Add the ImageComponent to the current widget's components for it to be drawn
+        imageComponent->parent = uiManager.currentWidget;
         uiManager.currentWidget->components.push_back(imageComponent);
     }
 
@@ -2083,6 +1982,7 @@ void main()
         animatedImageComponent->height = height;
 
         // Add the AnimatedImageComponent to the current widget's components for it to be drawn
+        animatedImageComponent->parent = uiManager.currentWidget;
         uiManager.currentWidget->components.push_back(animatedImageComponent);
     }
     void Tabs(int x, int y, int width, int height, const std::string& text, std::function<void()> onClick) {
@@ -2099,6 +1999,7 @@ void main()
         tab->height = height;
 
         // Add the Tab to the current widget's components for it to be drawn and interacted with
+        tab->parent = uiManager.currentWidget;
         uiManager.currentWidget->components.push_back(tab);
     }
 
@@ -2117,6 +2018,7 @@ void main()
         fileBrowser->height = height;
 
         // Add the FileBrowser to the current widget's components for it to be drawn and interacted with
+        fileBrowser->parent = uiManager.currentWidget;
         uiManager.currentWidget->components.push_back(fileBrowser);
     }
 
@@ -2135,6 +2037,7 @@ void main()
 		labelComponent->height = height;
 
 		// Add the LabelComponent to the current widget's components for it to be drawn
+		labelComponent->parent = uiManager.currentWidget;
 		uiManager.currentWidget->components.push_back(labelComponent);
 	}
 
@@ -2152,6 +2055,7 @@ void main()
 		tiledBG->height = height;
 
 		// Add the TiledBG to the current widget's components for it to be drawn
+		tiledBG->parent = uiManager.currentWidget;
 		uiManager.currentWidget->components.push_back(tiledBG);
 	}
 
@@ -2162,11 +2066,11 @@ void main()
                 auto widget = *it;
                 widget->isActive = false;
                 widget->isVisable = false;
+                uiManager.damageWidget(*widget);
 
-                // Check for errors
-                if (widget->texture) {
-                    glDeleteTextures(1, &widget->texture);
-                }
+                TextureCache::Release(widget->texture);
+                destroyRenderTarget(widget->cache);
+                releaseRetainedList(widget->retained);
 
                 // Delete components
                 for (auto component : widget->components) {
@@ -2194,17 +2098,215 @@ void main()
         uiManager.isCreatingWidget = false;
     }
 
+    // Redraw everything on the next renderUI(), for when the host clobbers UI state
+    void invalidateUI() {
+        uiManager.addDamage(0, 0, std::max(renderTargetWidth, 1), std::max(renderTargetHeight, 1));
+    }
+
+    bool animationDue(const Widget& widget) {
+        for (auto component : widget.components) {
+            if (component->animationDelay() == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Dirties every widget with an animation that came due, renderUI() calls it each frame
+    void pollAnimations() {
+        for (auto widget : uiManager.widgets) {
+            if (animationDue(*widget)) {
+                widget->markDirty();
+            }
+        }
+    }
+
+    // False when the last frame is still correct, so the host can skip rendering
+    // and presenting altogether. Only looks, nothing is marked dirty.
+    bool needsRedraw() {
+        if (TextureCache::HasPendingUploads()) {
+            return true;
+        }
+        if (uiManager.frame.width != std::max(renderTargetWidth, 1) || uiManager.frame.height != std::max(renderTargetHeight, 1)) {
+            return true;
+        }
+        if (uiManager.damage.width > 0 && uiManager.damage.height > 0) {
+            return true;
+        }
+        for (auto widget : uiManager.widgets) {
+            if (animationDue(*widget)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Record damaged widgets on the worker pool instead of one after another on
+    // the GL thread. Pays off with hundreds of widgets, off by default.
+    bool parallelRecording = false;
+
+    void setParallelRecording(bool enabled) {
+        parallelRecording = enabled;
+    }
+
+    std::vector<DrawList> widgetDrawLists; // One per widget in draw order, kept for their capacity
+
+    // Each widget records into its own list on the pool, idle threads pick up the
+    // next widget. The lists are then submitted here in z order.
+    void drawWidgetsParallel(const std::vector<Widget*>& drawOrder, const ScissorRect& damage) {
+        enum { WIDGET_SKIP, WIDGET_DRAW, WIDGET_CACHE_RENDER, WIDGET_CACHE_REUSE, WIDGET_RETAIN_RENDER, WIDGET_RETAIN_REUSE };
+        std::vector<int> mode(drawOrder.size());
+        std::vector<char> refused(drawOrder.size(), 0);
+        for (size_t i = 0; i < drawOrder.size(); i++) {
+            const Widget& widget = *drawOrder[i];
+            if (!uiManager.isDamaged(widget)) {
+                mode[i] = WIDGET_SKIP;
+            }
+            else if (widget.isCached) {
+                mode[i] = cacheIsStale(widget) ? WIDGET_CACHE_RENDER : WIDGET_CACHE_REUSE;
+            }
+            else if (retainWidgets) {
+                mode[i] = retainedIsStale(widget) ? WIDGET_RETAIN_RENDER : WIDGET_RETAIN_REUSE;
+            }
+            else {
+                mode[i] = WIDGET_DRAW;
+            }
+        }
+        if (widgetDrawLists.size() < drawOrder.size()) {
+            widgetDrawLists.resize(drawOrder.size());
+        }
+
+        recordingOffThread = true;
+        holdGlyphEviction = true;
+        workerPool().parallelFor(drawOrder.size(), [&](size_t i) {
+            if (mode[i] != WIDGET_DRAW && mode[i] != WIDGET_CACHE_RENDER && mode[i] != WIDGET_RETAIN_RENDER) {
+                return;
+            }
+            DrawList& list = widgetDrawLists[i];
+            if (mode[i] == WIDGET_DRAW) {
+                // Cached and retained widgets are recorded unclipped and clipped when submitted
+                list.scissorStack.push_back(intersectScissor(damage, uiManager.widgetClip(*drawOrder[i])));
+            }
+            recordingList = &list;
+            recordingRefused = false;
+            drawWidget(*drawOrder[i]);
+            refused[i] = recordingRefused;
+            recordingRefused = false;
+            recordingList = nullptr;
+            list.scissorStack.clear();
+            list.layer = 0;
+        });
+        recordingOffThread = false;
+        runDeferredGL();
+
+        for (size_t i = 0; i < drawOrder.size(); i++) {
+            Widget& widget = *drawOrder[i];
+            DrawList* recorded = &widgetDrawLists[i];
+            if (refused[i]) {
+                clearDrawList(*recorded);
+                recorded = nullptr; // Needed GL, record it again here
+            }
+            ScissorRect clip = uiManager.widgetClip(widget);
+            switch (mode[i]) {
+            case WIDGET_SKIP:
+                renderStats.widgetsSkipped++;
+                break;
+            case WIDGET_DRAW:
+                if (recorded) {
+                    appendDrawList(*recorded);
+                }
+                else {
+                    beginScissor(clip.x, clip.y, clip.width, clip.height);
+                    drawWidget(widget);
+                    endScissor();
+                }
+                break;
+            case WIDGET_RETAIN_RENDER:
+            case WIDGET_RETAIN_REUSE:
+                beginScissor(clip.x, clip.y, clip.width, clip.height);
+                drawRetainedWidget(widget, recorded);
+                endScissor();
+                break;
+            default:
+                drawCachedWidget(widget, recorded);
+                break;
+            }
+        }
+        holdGlyphEviction = false;
+    }
+
     void renderUI() {
-        for (auto& widget : uiManager.widgets) {
-            drawWidget(*widget); // Draw the widget itself
+        renderStats = RenderStats();
+        glStateStats = GLStateStats();
+        invalidateGLState(); // The host may have drawn with raw GL since the last frame
+
+        // Swap placeholders for images that finished loading. Widgets don't track
+        // which textures they use, so every widget redraws; this only happens while loading.
+        if (TextureCache::Update()) {
+            for (auto widget : uiManager.widgets) {
+                widget->markDirty();
+            }
+        }
+        pollAnimations();
+
+        if (resizeRenderTarget(uiManager.frame, renderTargetWidth, renderTargetHeight)) {
+            invalidateUI();
+        }
 
-            // Now draw the components of the widget
-            for (auto& component : widget->components) {
-                component->Draw(); // This includes TextComponent, ButtonComponent, and dropDownComponent
+        if (uiManager.damage.width > 0 && uiManager.damage.height > 0) {
+            const ScissorRect damage = uiManager.damage;
 
+            // Draw back to front; stable so widgets sharing a zOrder keep creation order
+            std::vector<Widget*> drawOrder = uiManager.widgets;
+            std::stable_sort(drawOrder.begin(), drawOrder.end(), [](const Widget* a, const Widget* b) {
+                return a->zOrder < b->zOrder;
+            });
 
+            beginRenderTarget(uiManager.frame, 0, 0, false);
+            beginScissor(damage.x, damage.y, damage.width, damage.height);
+            applyScissor(); // Recorded draws carry their own clip, the clear needs it set now
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            // Anything overlapping the damage is redrawn, the scissor keeps the rest of the frame intact.
+            // Retained lists recorded this pass must keep their glyphs until the flush.
+            holdGlyphEviction = retainWidgets;
+            if (parallelRecording && workerPool().size() > 0 && drawOrder.size() > 1) {
+                drawWidgetsParallel(drawOrder, damage);
+            }
+            else {
+                for (auto& widget : drawOrder) {
+                    if (!uiManager.isDamaged(*widget)) {
+                        renderStats.widgetsSkipped++;
+                    }
+                    else if (widget->isCached) {
+                        drawCachedWidget(*widget);
+                    }
+                    else {
+                        // Cached widgets are clipped by their texture, the rest to their damage area
+                        ScissorRect clip = uiManager.widgetClip(*widget);
+                        beginScissor(clip.x, clip.y, clip.width, clip.height);
+                        if (retainWidgets) {
+                            drawRetainedWidget(*widget);
+                        }
+                        else {
+                            drawWidget(*widget);
+                        }
+                        endScissor();
+                    }
+                }
             }
+            holdGlyphEviction = false;
+
+            endScissor();
+            endRenderTarget();
+            uiManager.damage = ScissorRect();
+            renderStats.damagedPixels = damage.width * damage.height;
         }
+
+        compositeRenderTarget(uiManager.frame, 0.0f, 0.0f);
+        endStreamFrame();
+        bindVertexArray(0); // Keep host buffer binds from landing in our VAO
     }
 
     void handleEvents(SDL_Event* event) {
@@ -2213,6 +2315,197 @@ void main()
         }
     }
 
+    ////////////////////////////////////////////////////////////////////////////
+    ///////////////////////////////TIMERS/////////////////////////////////////
+    // Callbacks fired from the main loop, so they can touch the UI freely.
+    // run() sleeps until the next one is due instead of polling.
+    struct Timer {
+        int ID = 0;
+        Uint32 due = 0;
+        Uint32 interval = 0;
+        bool repeat = false;
+        std::function<void()> callback;
+    };
+
+    std::vector<Timer> timers;
+    int nextTimerID = 1;
+
+    int setTimer(Uint32 delayMs, std::function<void()> callback, bool repeat = false) {
+        Timer timer;
+        timer.ID = nextTimerID++;
+        timer.due = SDL_GetTicks() + delayMs;
+        timer.interval = std::max<Uint32>(delayMs, 1);
+        timer.repeat = repeat;
+        timer.callback = std::move(callback);
+        timers.push_back(std::move(timer));
+        return timers.back().ID;
+    }
+
+    void clearTimer(int ID) {
+        timers.erase(std::remove_if(timers.begin(), timers.end(), [ID](const Timer& timer) {
+            return timer.ID == ID;
+        }), timers.end());
+    }
+
+    void runTimers() {
+        Uint32 now = SDL_GetTicks();
+        // Callbacks may add or clear timers, so fire from a snapshot of what is due
+        std::vector<Timer> due;
+        for (auto it = timers.begin(); it != timers.end();) {
+            if (static_cast<Sint32>(now - it->due) >= 0) {
+                due.push_back(*it);
+                if (it->repeat) {
+                    it->due = now + it->interval;
+                    ++it;
+                }
+                else {
+                    it = timers.erase(it);
+                }
+            }
+            else {
+                ++it;
+            }
+        }
+        for (auto& timer : due) {
+            timer.callback();
+        }
+    }
+
+    // Milliseconds until a timer or animation needs attention, -1 when nothing is scheduled
+    int nextWakeDelay(bool includeAnimations = true) {
+        int delay = -1;
+        Uint32 now = SDL_GetTicks();
+        for (auto& timer : timers) {
+            int remaining = std::max(static_cast<Sint32>(timer.due - now), 0);
+            delay = delay < 0 ? remaining : std::min(delay, remaining);
+        }
+        if (includeAnimations) {
+            for (auto widget : uiManager.widgets) {
+                for (auto component : widget->components) {
+                    int remaining = component->animationDelay();
+                    if (remaining >= 0) {
+                        delay = delay < 0 ? remaining : std::min(delay, remaining);
+                    }
+                }
+            }
+        }
+        return delay;
+    }
+
+#ifdef SETUP_SDL_OPENGL
+    ////////////////////////////////////////////////////////////////////////////
+    ///////////////////////////////MAIN LOOP//////////////////////////////////
+    struct RunOptions {
+        int maxFPS = 60;                 // 0 leaves pacing to vsync alone
+        VSyncMode vsync = VSYNC_ADAPTIVE;
+        bool lowPower = false;           // Cap at lowPowerFPS instead of maxFPS
+        int lowPowerFPS = 15;
+        std::function<void(SDL_Event&)> onEvent; // Sees every event before the UI does
+        std::function<void()> onRender;          // Draw your own scene, called after the clear and before the UI
+    };
+
+    RunOptions runOptions;
+    bool runQuit = false;
+    bool frameRequested = false;
+
+    // Present on the next iteration even though the UI is unchanged, e.g. the host scene moved
+    void requestFrame() {
+        frameRequested = true;
+    }
+
+    void stopRun() {
+        runQuit = true;
+    }
+
+    void setLowPowerMode(bool enabled) {
+        runOptions.lowPower = enabled;
+    }
+
+    // Event-driven loop. Blocks in SDL_WaitEventTimeout while the UI is idle and
+    // wakes for input, timers and animation frames. Nothing is drawn or presented
+    // while minimized or when the last frame is still correct.
+    void run(const RunOptions& options = RunOptions()) {
+        runOptions = options;
+        runQuit = false;
+        setVSync(runOptions.vsync);
+
+        bool minimized = false;
+        bool exposed = true;
+        Uint32 lastPresent = 0;
+        SDL_Event event;
+
+        while (!runQuit) {
+            int fps = runOptions.lowPower ? runOptions.lowPowerFPS : runOptions.maxFPS;
+            Uint32 frameMs = fps > 0 ? 1000 / static_cast<Uint32>(fps) : 0;
+            Uint32 now = SDL_GetTicks();
+
+            int timeout;
+            if (!minimized && (exposed || frameRequested || needsRedraw())) {
+                // A frame is owed, keep taking input until the frame cap allows it
+                Uint32 sincePresent = now - lastPresent;
+                timeout = sincePresent < frameMs ? static_cast<int>(frameMs - sincePresent) : 0;
+            }
+            else {
+                timeout = nextWakeDelay(!minimized);
+            }
+
+            bool hasEvent = timeout < 0 ? SDL_WaitEvent(&event) != 0 : SDL_WaitEventTimeout(&event, timeout) != 0;
+            while (hasEvent) {
+                if (event.type == SDL_QUIT) {
+                    runQuit = true;
+                }
+                else if (event.type == SDL_WINDOWEVENT) {
+                    switch (event.window.event) {
+                    case SDL_WINDOWEVENT_SIZE_CHANGED:
+                        setProjectionMatrix(event.window.data1, event.window.data2);
+                        setViewport(0, 0, event.window.data1, event.window.data2);
+                        break;
+                    case SDL_WINDOWEVENT_MINIMIZED:
+                    case SDL_WINDOWEVENT_HIDDEN:
+                        minimized = true;
+                        break;
+                    case SDL_WINDOWEVENT_RESTORED:
+                    case SDL_WINDOWEVENT_MAXIMIZED:
+                    case SDL_WINDOWEVENT_SHOWN:
+                        minimized = false;
+                        exposed = true;
+                        break;
+                    case SDL_WINDOWEVENT_EXPOSED:
+                        exposed = true;
+                        break;
+                    }
+                }
+                if (runOptions.onEvent) {
+                    runOptions.onEvent(event);
+                }
+                handleEvents(&event);
+                hasEvent = SDL_PollEvent(&event) != 0;
+            }
+
+            runTimers();
+
+            now = SDL_GetTicks();
+            if (runQuit || minimized || now - lastPresent < frameMs) {
+                continue;
+            }
+            if (!exposed && !frameRequested && !needsRedraw()) {
+                continue;
+            }
+
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            if (runOptions.onRender) {
+                runOptions.onRender();
+            }
+            renderUI();
+            SDL_GL_SwapWindow(g_window);
+
+            lastPresent = now;
+            exposed = false;
+            frameRequested = false;
+        }
+    }
+#endif
 
 
 } // namespace SV_UI
@@ -6,6 +6,40 @@
 #include <GL/glew.h>
 #include <GL/glu.h> // Include GLU header
 #include <iostream>
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <filesystem>
+#include <cstring>
+#include <climits>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ATLAS_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace Atlas {
     GLuint shaderProgram; // shader program declaration
@@ -30,6 +64,31 @@ namespace Atlas {
     // Add SDL_Renderer declaration
     SDL_Renderer* g_renderer = nullptr;
 
+    // Values match SDL_GL_SetSwapInterval
+    enum VSyncMode {
+        VSYNC_OFF = 0,
+        VSYNC_ON = 1,
+        VSYNC_ADAPTIVE = -1 // Syncs when on time, tears instead of stalling a whole frame when late
+    };
+
+    VSyncMode g_vsync = VSYNC_OFF;
+
+    // Not every driver supports adaptive or even regular vsync, so fall back
+    // one step at a time. Returns the mode that actually took.
+    VSyncMode setVSync(VSyncMode mode) {
+        if (mode == VSYNC_ADAPTIVE && SDL_GL_SetSwapInterval(VSYNC_ADAPTIVE) == 0) {
+            return g_vsync = VSYNC_ADAPTIVE;
+        }
+        if (mode != VSYNC_OFF && SDL_GL_SetSwapInterval(VSYNC_ON) == 0) {
+            return g_vsync = VSYNC_ON;
+        }
+        if (mode != VSYNC_OFF) {
+            std::cerr << "VSync unavailable, frames will be paced by the frame cap: " << SDL_GetError() << std::endl;
+        }
+        SDL_GL_SetSwapInterval(VSYNC_OFF);
+        return g_vsync = VSYNC_OFF;
+    }
+
     // Streamlined Setup function
     bool Setup(const std::string& windowName, int windowWidth = SCREEN_WIDTH, int windowHeight = SCREEN_HEIGHT) {
         if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -60,10 +119,7 @@ namespace Atlas {
             return false;
         }
 
-        if (SDL_GL_SetSwapInterval(1) < 0) {
-            std::cerr << "Failed to set VSync: " << SDL_GetError() << std::endl;
-            return false;
-        }
+        setVSync(VSYNC_ADAPTIVE);
 
         glewExperimental = GL_TRUE;
         GLenum err = glewInit();
@@ -83,7 +139,17 @@ namespace Atlas {
         return true;
     }
 
+    // Run by Shutdown while the GL context is still alive, for caches that read GL state back
+    std::vector<std::function<void()>>& shutdownHooks() {
+        static std::vector<std::function<void()>> hooks;
+        return hooks;
+    }
+
     void Shutdown() {
+        for (auto& hook : shutdownHooks()) {
+            hook();
+        }
+        shutdownHooks().clear();
         if (g_renderer) {
             SDL_DestroyRenderer(g_renderer);
             g_renderer = nullptr;
@@ -198,6 +264,210 @@ namespace Atlas {
         }
     }
 
+    ////////////GL STATE CACHE/////////////////////////
+    ///////////////////////////////////////////////////
+    // Everything Atlas binds goes through these so redundant changes never reach the driver.
+    // Unknown state (after invalidateGLState) is always re-issued on the next set.
+    const GLuint glStateUnknown = 0xFFFFFFFFu;
+    const int glStateTextureUnits = 8;
+
+    struct GLStateCache {
+        GLuint program = glStateUnknown;
+        GLuint vao = glStateUnknown;
+        GLuint framebuffer = glStateUnknown;
+        GLuint activeUnit = glStateUnknown;
+        GLuint textures[glStateTextureUnits];
+        int blendEnabled = -1;   // -1 unknown, 0 off, 1 on
+        int scissorEnabled = -1;
+        bool blendFuncKnown = false;
+        GLint blendFunc[4] = { 0, 0, 0, 0 }; // src rgb, dst rgb, src alpha, dst alpha
+        bool scissorKnown = false;
+        GLint scissor[4] = { 0, 0, 0, 0 };
+        bool viewportKnown = false;
+        GLint viewport[4] = { 0, 0, 0, 0 };
+        std::unordered_map<GLuint, std::unordered_map<std::string, GLint>> uniforms;
+
+        GLStateCache() {
+            for (GLuint& texture : textures) texture = glStateUnknown;
+        }
+    };
+
+    struct GLStateStats {
+        int issued = 0;        // state calls that reached GL
+        int elided = 0;        // state calls skipped because nothing changed
+        int uniformLookups = 0;
+        int uniformCacheHits = 0;
+    };
+
+    GLStateCache glState;
+    GLStateStats glStateStats;
+
+    // Call after drawing with raw GL between Atlas calls. renderUI does this itself each frame.
+    void invalidateGLState() {
+        glState.program = glStateUnknown;
+        glState.vao = glStateUnknown;
+        glState.framebuffer = glStateUnknown;
+        glState.activeUnit = glStateUnknown;
+        for (GLuint& texture : glState.textures) texture = glStateUnknown;
+        glState.blendEnabled = -1;
+        glState.scissorEnabled = -1;
+        glState.blendFuncKnown = false;
+        glState.scissorKnown = false;
+        glState.viewportKnown = false;
+    }
+
+    void useProgram(GLuint program) {
+        if (glState.program == program) { glStateStats.elided++; return; }
+        glUseProgram(program);
+        glState.program = program;
+        glStateStats.issued++;
+    }
+
+    void bindVertexArray(GLuint vao) {
+        if (glState.vao == vao) { glStateStats.elided++; return; }
+        glBindVertexArray(vao);
+        glState.vao = vao;
+        glStateStats.issued++;
+    }
+
+    void bindFramebuffer(GLuint framebuffer) {
+        if (glState.framebuffer == framebuffer) { glStateStats.elided++; return; }
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glState.framebuffer = framebuffer;
+        glStateStats.issued++;
+    }
+
+    // Only asks GL when the binding is unknown
+    GLuint currentFramebuffer() {
+        if (glState.framebuffer == glStateUnknown) {
+            GLint bound = 0;
+            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &bound);
+            glState.framebuffer = static_cast<GLuint>(bound);
+        }
+        return glState.framebuffer;
+    }
+
+    // Binds a GL_TEXTURE_2D on the given unit, switching the active unit only when needed
+    void bindTexture(GLuint texture, int unit = 0) {
+        if (glState.textures[unit] == texture && glState.activeUnit == static_cast<GLuint>(unit)) {
+            glStateStats.elided++;
+            return;
+        }
+        if (glState.activeUnit != static_cast<GLuint>(unit)) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glState.activeUnit = unit;
+            glStateStats.issued++;
+        }
+        if (glState.textures[unit] == texture) { glStateStats.elided++; return; }
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glState.textures[unit] = texture;
+        glStateStats.issued++;
+    }
+
+    // Deleting a bound texture resets the binding to 0 in GL, mirror that so a recycled id is rebound
+    void forgetTexture(GLuint texture) {
+        for (GLuint& bound : glState.textures) {
+            if (bound == texture) bound = 0;
+        }
+    }
+
+    void forgetVertexArray(GLuint vao) {
+        if (glState.vao == vao) glState.vao = 0;
+    }
+
+    void forgetFramebuffer(GLuint framebuffer) {
+        if (glState.framebuffer == framebuffer) glState.framebuffer = 0;
+    }
+
+    void setBlendEnabled(bool enabled) {
+        if (glState.blendEnabled == (enabled ? 1 : 0)) { glStateStats.elided++; return; }
+        if (enabled) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+        glState.blendEnabled = enabled ? 1 : 0;
+        glStateStats.issued++;
+    }
+
+    void setBlendFunc(GLint srcRGB, GLint dstRGB, GLint srcAlpha, GLint dstAlpha) {
+        GLint* f = glState.blendFunc;
+        if (glState.blendFuncKnown && f[0] == srcRGB && f[1] == dstRGB && f[2] == srcAlpha && f[3] == dstAlpha) {
+            glStateStats.elided++;
+            return;
+        }
+        glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+        f[0] = srcRGB; f[1] = dstRGB; f[2] = srcAlpha; f[3] = dstAlpha;
+        glState.blendFuncKnown = true;
+        glStateStats.issued++;
+    }
+
+    void setBlendFunc(GLint src, GLint dst) {
+        setBlendFunc(src, dst, src, dst);
+    }
+
+    // Only asks GL when the blend function is unknown
+    void getBlendFunc(GLint out[4]) {
+        if (!glState.blendFuncKnown) {
+            glGetIntegerv(GL_BLEND_SRC_RGB, &glState.blendFunc[0]);
+            glGetIntegerv(GL_BLEND_DST_RGB, &glState.blendFunc[1]);
+            glGetIntegerv(GL_BLEND_SRC_ALPHA, &glState.blendFunc[2]);
+            glGetIntegerv(GL_BLEND_DST_ALPHA, &glState.blendFunc[3]);
+            glState.blendFuncKnown = true;
+        }
+        std::memcpy(out, glState.blendFunc, sizeof(glState.blendFunc));
+    }
+
+    void setScissorEnabled(bool enabled) {
+        if (glState.scissorEnabled == (enabled ? 1 : 0)) { glStateStats.elided++; return; }
+        if (enabled) glEnable(GL_SCISSOR_TEST); else glDisable(GL_SCISSOR_TEST);
+        glState.scissorEnabled = enabled ? 1 : 0;
+        glStateStats.issued++;
+    }
+
+    void setScissorBox(GLint x, GLint y, GLsizei width, GLsizei height) {
+        GLint* s = glState.scissor;
+        if (glState.scissorKnown && s[0] == x && s[1] == y && s[2] == width && s[3] == height) {
+            glStateStats.elided++;
+            return;
+        }
+        glScissor(x, y, width, height);
+        s[0] = x; s[1] = y; s[2] = width; s[3] = height;
+        glState.scissorKnown = true;
+        glStateStats.issued++;
+    }
+
+    void setViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+        GLint* v = glState.viewport;
+        if (glState.viewportKnown && v[0] == x && v[1] == y && v[2] == width && v[3] == height) {
+            glStateStats.elided++;
+            return;
+        }
+        glViewport(x, y, width, height);
+        v[0] = x; v[1] = y; v[2] = width; v[3] = height;
+        glState.viewportKnown = true;
+        glStateStats.issued++;
+    }
+
+    // Only asks GL when the viewport is unknown
+    void getViewport(GLint out[4]) {
+        if (!glState.viewportKnown) {
+            glGetIntegerv(GL_VIEWPORT, glState.viewport);
+            glState.viewportKnown = true;
+        }
+        std::memcpy(out, glState.viewport, sizeof(glState.viewport));
+    }
+
+    // Uniform locations never change for a linked program so each name is looked up once
+    GLint uniformLocation(GLuint program, const char* name) {
+        auto& locations = glState.uniforms[program];
+        auto it = locations.find(name);
+        if (it != locations.end()) {
+            glStateStats.uniformCacheHits++;
+            return it->second;
+        }
+        GLint location = glGetUniformLocation(program, name);
+        locations.emplace(name, location);
+        glStateStats.uniformLookups++;
+        return location;
+    }
+
     enum class Alignment {
         TopLeft,
         TopCenter,
@@ -300,48 +570,1030 @@ namespace Atlas {
 
 #endif
 
+    ////////////////////////////////////////////////////////////////
+    /////////////////FILE MAPPING//////////////////////////////////
+    ///////////////////////////////////////////////////////////////
+    // Read only view of a whole file. The OS pages it in on demand so large
+    // caches can be handed to GL without copying them into our own buffers.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string& path) { open(path); }
+        ~MappedFile() { close(); }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const std::string& path) {
+            close();
+#ifdef _WIN32
+            fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (fileHandle == INVALID_HANDLE_VALUE) {
+                return false;
+            }
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+                close();
+                return false;
+            }
+            mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (!mappingHandle) {
+                close();
+                return false;
+            }
+            bytes = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+            length = static_cast<size_t>(fileSize.QuadPart);
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return false;
+            }
+            struct stat info;
+            if (fstat(fd, &info) != 0 || info.st_size == 0) {
+                ::close(fd);
+                return false;
+            }
+            void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd); // The mapping keeps the file alive
+            if (mapping == MAP_FAILED) {
+                return false;
+            }
+            bytes = static_cast<const unsigned char*>(mapping);
+            length = static_cast<size_t>(info.st_size);
+#endif
+            if (!bytes) {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        void close() {
+#ifdef _WIN32
+            if (bytes) {
+                UnmapViewOfFile(bytes);
+            }
+            if (mappingHandle) {
+                CloseHandle(mappingHandle);
+            }
+            if (fileHandle != INVALID_HANDLE_VALUE) {
+                CloseHandle(fileHandle);
+            }
+            mappingHandle = NULL;
+            fileHandle = INVALID_HANDLE_VALUE;
+#else
+            if (bytes) {
+                munmap(const_cast<unsigned char*>(bytes), length);
+            }
+#endif
+            bytes = nullptr;
+            length = 0;
+        }
+
+        const unsigned char* data() const { return bytes; }
+        size_t size() const { return length; }
+        bool isOpen() const { return bytes != nullptr; }
+
+    private:
+        const unsigned char* bytes = nullptr;
+        size_t length = 0;
+#ifdef _WIN32
+        HANDLE fileHandle = INVALID_HANDLE_VALUE;
+        HANDLE mappingHandle = NULL;
+#endif
+    };
+
+    // 64 bit FNV-1a, used to tell when a cached file no longer matches its source
+    uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    ////////////////////////////////////////////////////////////////
+    /////////////////WORKER THREADS////////////////////////////////
+    ///////////////////////////////////////////////////////////////
+    // Fixed pool for CPU side work such as glyph rasterization. Jobs must not
+    // touch GL, their results are handed back to the GL thread for upload.
+    class ThreadPool {
+    public:
+        explicit ThreadPool(unsigned threadCount) {
+            for (unsigned i = 0; i < threadCount; i++) {
+                workers.emplace_back([this] { workerLoop(); });
+            }
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        void submit(std::function<void()> job) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.push_back(std::move(job));
+            }
+            wake.notify_one();
+        }
+
+        // Runs body(i) for every i in [0, count) on the pool and the calling
+        // thread, and returns once all of them have finished
+        void parallelFor(size_t count, const std::function<void(size_t)>& body) {
+            if (count == 0) {
+                return;
+            }
+
+            // Shared so a helper that only starts after we returned finds no work left
+            struct Progress {
+                std::atomic<size_t> next{ 0 };
+                std::atomic<size_t> finished{ 0 };
+                std::mutex mutex;
+                std::condition_variable done;
+            };
+            auto progress = std::make_shared<Progress>();
+            const std::function<void(size_t)>* work = &body;
+
+            auto drain = [progress, work, count] {
+                size_t index;
+                while ((index = progress->next.fetch_add(1)) < count) {
+                    (*work)(index);
+                    if (progress->finished.fetch_add(1) + 1 == count) {
+                        std::lock_guard<std::mutex> lock(progress->mutex);
+                        progress->done.notify_all();
+                    }
+                }
+            };
+
+            size_t helpers = std::min(count - 1, workers.size());
+            for (size_t i = 0; i < helpers; i++) {
+                submit(drain);
+            }
+            drain();
+
+            std::unique_lock<std::mutex> lock(progress->mutex);
+            progress->done.wait(lock, [&] { return progress->finished.load() == count; });
+        }
+
+        size_t size() const { return workers.size(); }
+
+    private:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+
+        void workerLoop() {
+            for (;;) {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+                    if (stopping && jobs.empty()) {
+                        return;
+                    }
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+                job();
+            }
+        }
+    };
+
+    // Shared pool, one worker per core besides the calling thread
+    ThreadPool& workerPool() {
+        static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    ////////////ATLAS PACKING///////////////////////////////////////
+    // Packs rects left to right into rows ("shelves"). Good enough for glyphs
+    // and small UI images where sizes are similar.
+    struct ShelfPacker {
+        int width = 0, height = 0;
+        int padding = 1; // gap between rects so linear filtering does not bleed
+        int cursorX = 0, cursorY = 0;
+        int shelfHeight = 0;
+
+        ShelfPacker(int width = 0, int height = 0, int padding = 1)
+            : width(width), height(height), padding(padding) {}
+
+        // Returns false when the rect does not fit in the remaining space
+        bool pack(int w, int h, int& outX, int& outY) {
+            if (w + padding > width) {
+                return false;
+            }
+            // Only move to a new shelf once the rect is known to fit, a failed
+            // request must not throw away the rest of the current one
+            int x = cursorX, y = cursorY, shelf = shelfHeight;
+            if (x + w + padding > width) {
+                x = 0;
+                y += shelf;
+                shelf = 0;
+            }
+            if (y + h + padding > height) {
+                return false;
+            }
+            outX = x;
+            outY = y;
+            cursorX = x + w + padding;
+            cursorY = y;
+            shelfHeight = std::max(shelf, h + padding);
+            return true;
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////
+    ////////////IMAGE SCALING///////////////////////////////////////
+    // Area-average downscale for RGBA8. Every source texel contributes by how
+    // much of it an output texel covers, which is what a box-filtered mip chain
+    // approximates but at any ratio. Color is averaged premultiplied so
+    // transparent texels don't darken edges. Only meant for shrinking.
+    struct ResampleTap {
+        int first = 0; // First source texel
+        int count = 0;
+        std::vector<float> weights;
+    };
+
+    std::vector<ResampleTap> resampleTaps(int sourceSize, int targetSize) {
+        std::vector<ResampleTap> taps(targetSize);
+        double scale = static_cast<double>(sourceSize) / targetSize;
+        for (int i = 0; i < targetSize; i++) {
+            double start = i * scale;
+            double end = std::min((i + 1) * scale, static_cast<double>(sourceSize));
+            ResampleTap& tap = taps[i];
+            tap.first = static_cast<int>(start);
+            int last = std::min(static_cast<int>(std::ceil(end)), sourceSize);
+            tap.count = std::max(last - tap.first, 1);
+            for (int s = tap.first; s < tap.first + tap.count; s++) {
+                double covered = std::min(end, s + 1.0) - std::max(start, static_cast<double>(s));
+                tap.weights.push_back(static_cast<float>(std::max(covered, 0.0) / (end - start)));
+            }
+        }
+        return taps;
+    }
+
+    void resampleRGBA(const unsigned char* source, int sourceWidth, int sourceHeight, int sourcePitch,
+        unsigned char* target, int targetWidth, int targetHeight, int targetPitch) {
+        std::vector<ResampleTap> columns = resampleTaps(sourceWidth, targetWidth);
+        std::vector<ResampleTap> rows = resampleTaps(sourceHeight, targetHeight);
+        // Horizontal pass into premultiplied float texels, one source row at a time
+        std::vector<float> wide(static_cast<size_t>(targetWidth) * sourceHeight * 4);
+
+        for (int y = 0; y < sourceHeight; y++) {
+            const unsigned char* src = source + static_cast<size_t>(y) * sourcePitch;
+            float* dst = &wide[static_cast<size_t>(y) * targetWidth * 4];
+            for (int x = 0; x < targetWidth; x++) {
+                const ResampleTap& tap = columns[x];
+#ifdef ATLAS_SSE2
+                __m128 sum = _mm_setzero_ps();
+                const __m128i zero = _mm_setzero_si128();
+                for (int i = 0; i < tap.count; i++) {
+                    int texel;
+                    std::memcpy(&texel, src + (tap.first + i) * 4, 4);
+                    __m128 color = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(texel), zero), zero));
+                    // Scale rgb by alpha / 255, alpha by 1
+                    __m128 alpha = _mm_shuffle_ps(color, color, _MM_SHUFFLE(3, 3, 3, 3));
+                    __m128 premultiply = _mm_mul_ps(alpha, _mm_set_ps(0.0f, 1.0f / 255.0f, 1.0f / 255.0f, 1.0f / 255.0f));
+                    premultiply = _mm_add_ps(premultiply, _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f));
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_mul_ps(color, premultiply), _mm_set1_ps(tap.weights[i])));
+                }
+                _mm_storeu_ps(dst + x * 4, sum);
+#else
+                float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                for (int i = 0; i < tap.count; i++) {
+                    const unsigned char* texel = src + (tap.first + i) * 4;
+                    float weight = tap.weights[i];
+                    float alpha = texel[3] / 255.0f;
+                    sum[0] += texel[0] * alpha * weight;
+                    sum[1] += texel[1] * alpha * weight;
+                    sum[2] += texel[2] * alpha * weight;
+                    sum[3] += texel[3] * weight;
+                }
+                std::memcpy(dst + x * 4, sum, sizeof(sum));
+#endif
+            }
+        }
+
+        // Vertical pass, then back to straight alpha bytes
+        for (int y = 0; y < targetHeight; y++) {
+            const ResampleTap& tap = rows[y];
+            unsigned char* dst = target + static_cast<size_t>(y) * targetPitch;
+            for (int x = 0; x < targetWidth; x++) {
+#ifdef ATLAS_SSE2
+                __m128 sum = _mm_setzero_ps();
+                for (int i = 0; i < tap.count; i++) {
+                    __m128 texel = _mm_loadu_ps(&wide[(static_cast<size_t>(tap.first + i) * targetWidth + x) * 4]);
+                    sum = _mm_add_ps(sum, _mm_mul_ps(texel, _mm_set1_ps(tap.weights[i])));
+                }
+                float alpha = _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 3, 3)));
+                __m128 unpremultiply = alpha > 0.0f ? _mm_set_ps(1.0f, 255.0f / alpha, 255.0f / alpha, 255.0f / alpha) : _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+                __m128i packed = _mm_cvtps_epi32(_mm_mul_ps(sum, unpremultiply));
+                packed = _mm_packs_epi32(packed, packed);
+                packed = _mm_packus_epi16(packed, packed); // Saturates to 0..255
+                int texel = _mm_cvtsi128_si32(packed);
+                std::memcpy(dst + x * 4, &texel, 4);
+#else
+                float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                for (int i = 0; i < tap.count; i++) {
+                    const float* texel = &wide[(static_cast<size_t>(tap.first + i) * targetWidth + x) * 4];
+                    for (int c = 0; c < 4; c++) {
+                        sum[c] += texel[c] * tap.weights[i];
+                    }
+                }
+                float unpremultiply = sum[3] > 0.0f ? 255.0f / sum[3] : 0.0f;
+                for (int c = 0; c < 3; c++) {
+                    dst[x * 4 + c] = static_cast<unsigned char>(std::min(std::max(sum[c] * unpremultiply + 0.5f, 0.0f), 255.0f));
+                }
+                dst[x * 4 + 3] = static_cast<unsigned char>(std::min(std::max(sum[3] + 0.5f, 0.0f), 255.0f));
+#endif
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////
+    /////////////////SOFTWARE TEXTURE MIRROR///////////////////////
+    ///////////////////////////////////////////////////////////////
+    // CPU copies of GL textures for the software rasterizer in atlas_render_soft.h,
+    // keyed by GL texture id. GL textures can't be read back cheaply, so while the
+    // mirror is on TextureCache and the glyph atlases copy every upload here.
+    struct SoftTexture {
+        int width = 0, height = 0;
+        int channels = 4; // 4 for RGBA images, 1 for glyph pages
+        bool repeat = false; // GL_REPEAT wrapping, for textures loaded with TEXTURE_REPEAT
+        std::vector<unsigned char> texels;
+    };
+
+    std::unordered_map<GLuint, SoftTexture> softTextures;
+    bool mirrorSoftTextures = false;
+
+    // Turn on before loading images and fonts, textures uploaded earlier are not copied.
+    // Costs a CPU copy of every texture, so leave it off unless you rasterize on the CPU.
+    void setSoftTextureMirror(bool enabled) {
+        mirrorSoftTextures = enabled;
+        if (!enabled) {
+            softTextures.clear();
+        }
+    }
+
+    // texels are tightly packed rows, null leaves the texture cleared
+    void setSoftTexture(GLuint id, int width, int height, int channels, const unsigned char* texels = nullptr, bool repeat = false) {
+        SoftTexture& texture = softTextures[id];
+        texture.width = width;
+        texture.height = height;
+        texture.channels = channels;
+        texture.repeat = repeat;
+        texture.texels.assign(static_cast<size_t>(width) * height * channels, 0);
+        if (texels) {
+            std::memcpy(texture.texels.data(), texels, texture.texels.size());
+        }
+    }
+
+    // Same as glTexSubImage2D. pitch is the byte stride of texels, 0 for tightly packed rows.
+    void updateSoftTexture(GLuint id, int x, int y, int width, int height, const unsigned char* texels, int pitch = 0) {
+        auto it = softTextures.find(id);
+        if (it == softTextures.end()) {
+            return;
+        }
+        SoftTexture& texture = it->second;
+        size_t stride = pitch > 0 ? static_cast<size_t>(pitch) : static_cast<size_t>(width) * texture.channels;
+        int first = std::max(x, 0);
+        int last = std::min(x + width, texture.width);
+        if (first >= last) {
+            return;
+        }
+        for (int row = 0; row < height; row++) {
+            if (y + row < 0 || y + row >= texture.height) {
+                continue;
+            }
+            std::memcpy(&texture.texels[(static_cast<size_t>(y + row) * texture.width + first) * texture.channels],
+                texels + row * stride + static_cast<size_t>(first - x) * texture.channels, static_cast<size_t>(last - first) * texture.channels);
+        }
+    }
+
+    void removeSoftTexture(GLuint id) {
+        softTextures.erase(id);
+    }
+
     ////////////////////////////////////////////////////////////////
     /////////////////TEXTURE LOADING///////////////////////////////
     ///////////////////////////////////////////////////////////////
-// Define a struct to hold texture information
-    struct TextureInfo {
-        GLuint id;
-        int width;
-        int height;
+    // A decoded image on the GPU. Pointers stay valid until the last Release(),
+    // so components can hold them directly. uv is the sub-rect to sample as
+    // (u0, v0, u1, v1) with v0 at the top, a packed rect for atlased images.
+    // Async loads hand out the pointer at once; width, height and id are only
+    // valid once resident is set.
+    struct Texture {
+        GLuint id = 0;
+        int width = 0, height = 0;
+        glm::vec4 uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+        size_t bytes = 0;      // GPU memory this image accounts for
+        bool resident = false; // Uploaded and ready to sample
     };
 
-    // Update the loadTexture function to return TextureInfo
-    TextureInfo loadTexture(const char* path) {
-        SDL_Surface* surface = IMG_Load(path);
+    enum TextureFlags {
+        TEXTURE_DEFAULT = 0,
+        TEXTURE_REPEAT = 1 << 0,   // Wraps instead of clamping, for tiled backgrounds. Never atlased.
+        TEXTURE_NO_ATLAS = 1 << 1, // Own GL texture even when small, for callers that change its parameters
+        TEXTURE_ASYNC = 1 << 2     // Decode on the worker pool and stream the upload, see TextureCache::Update()
+    };
+
+    // Every image load goes through here, so a PNG used by fifty buttons is
+    // decoded and uploaded once. Entries are keyed by canonical path and freed
+    // when the last holder releases them. Small images share atlas pages, so a
+    // skinned panel's icons and frames batch into one or two draws.
+    //
+    // Callers pass the size they draw at. Images are shrunk to the largest size
+    // any holder asked for, so artwork dropped into a small slot costs slot-sized
+    // memory, and get mipmaps only when some holder draws them smaller than that.
+    class TextureCache {
+    public:
+        // displayWidth/Height of 0 keeps the full source resolution
+        static Texture* Acquire(const std::string& path, int flags = TEXTURE_DEFAULT, int displayWidth = 0, int displayHeight = 0);
+        static void Release(Texture* texture);
+
+        // Images with both sides at or below this many pixels are packed into
+        // shared pages, 0 turns packing off. Affects images loaded afterwards.
+        static void SetAtlasThreshold(int pixels) { atlasThreshold = pixels; }
+
+        // Bytes of texel data Update() may send to the GPU per call. Large
+        // images are uploaded a band of rows at a time across several frames.
+        static void SetUploadBudget(size_t bytes) { uploadBudget = std::max<size_t>(bytes, 1); }
+
+        // Uploads finished async decodes within the budget. Call once per frame
+        // on the GL thread; renderUI() does. Returns true when any texture became resident.
+        static bool Update();
+
+        // True when Update() has work, decoded images waiting or uploads in progress
+        static bool HasPendingUploads();
+
+        // Drawn in place of images that are still loading
+        static glm::vec4 placeholderColor;
+
+        // GPU bytes held by the cache, whole atlas pages included
+        static size_t ResidentBytes() { return residentBytes; }
+        static size_t Count() { return entries.size(); }
+        static size_t AtlasPageCount();
+
+        static const int atlasPageSize = 1024;
+
+    private:
+        struct Entry {
+            std::unique_ptr<Texture> texture;
+            std::string path;
+            int refCount = 0;
+            int page = -1; // Atlas page, -1 for a standalone texture
+            int flags = 0;
+            uint64_t serial = 0; // Newest load; results of older ones are dropped
+            int maxWidth = 0, maxHeight = 0;             // Largest display size asked for, INT_MAX for full resolution
+            int minWidth = INT_MAX, minHeight = INT_MAX; // Smallest explicit display size
+            int sourceWidth = 0, sourceHeight = 0;       // Known after the first decode
+            bool mipmapped = false;
+        };
+
+        // Space is only handed back when every image on a page is released,
+        // the shelf packer can't free single rects
+        struct AtlasPage {
+            GLuint texture = 0;
+            ShelfPacker packer;
+            int users = 0;
+        };
+
+        // A decoded surface waiting for, or partway through, its upload. Texels go
+        // into staging and replace the entry's storage only once complete, so a
+        // reload at a new size never shows a half-uploaded image.
+        struct PendingUpload {
+            std::string key;
+            uint64_t serial = 0;
+            SDL_Surface* surface = nullptr;
+            int sourceWidth = 0, sourceHeight = 0;
+            int row = 0; // Rows already uploaded
+            bool started = false;
+            bool mipmaps = false;
+            int page = -1;
+            Texture staging;
+        };
+
+        static std::string Key(const std::string& path, int flags);
+        static SDL_Surface* Decode(const std::string& path, int maxWidth, int maxHeight, int& sourceWidth, int& sourceHeight);
+        static bool RequestSize(Entry& entry, int displayWidth, int displayHeight);
+        static bool WantsMipmaps(const Entry& entry, int width, int height);
+        static bool Load(const std::string& key, Entry& entry, bool async);
+        static bool UploadStep(PendingUpload& pending, Entry& entry, size_t& budget);
+        static void UploadRegion(GLuint texture, int x, int y, int w, int h, const void* pixels, int pitch);
+        static void AllocateStandalone(Texture& texture, int flags, bool mipmaps);
+        static int UploadToAtlas(Texture& texture, SDL_Surface* surface);
+        static void FreeStorage(Texture& texture, int page);
+
+        static std::unordered_map<std::string, Entry> entries;
+        static std::unordered_map<const Texture*, std::string> keys;
+        static std::vector<AtlasPage> atlasPages;
+        static size_t residentBytes;
+        static int atlasThreshold;
+
+        static uint64_t nextSerial;
+        static GLuint uploadBuffer;
+        static size_t uploadBudget;
+        static Uint32 wakeEvent;
+        static std::mutex decodedMutex;
+        static std::vector<PendingUpload> decoded; // Filled by workers, guarded by decodedMutex
+        static std::deque<PendingUpload> uploads;  // GL thread only
+    };
+
+    std::unordered_map<std::string, TextureCache::Entry> TextureCache::entries;
+    std::unordered_map<const Texture*, std::string> TextureCache::keys;
+    std::vector<TextureCache::AtlasPage> TextureCache::atlasPages;
+    size_t TextureCache::residentBytes = 0;
+    int TextureCache::atlasThreshold = 128;
+    glm::vec4 TextureCache::placeholderColor = glm::vec4(0.5f, 0.5f, 0.5f, 0.25f);
+    uint64_t TextureCache::nextSerial = 1;
+    GLuint TextureCache::uploadBuffer = 0;
+    size_t TextureCache::uploadBudget = 4 * 1024 * 1024;
+    Uint32 TextureCache::wakeEvent = 0;
+    std::mutex TextureCache::decodedMutex;
+    std::vector<TextureCache::PendingUpload> TextureCache::decoded;
+    std::deque<TextureCache::PendingUpload> TextureCache::uploads;
+
+    size_t TextureCache::AtlasPageCount() {
+        return std::count_if(atlasPages.begin(), atlasPages.end(), [](const AtlasPage& page) {
+            return page.texture != 0;
+        });
+    }
+
+    std::string TextureCache::Key(const std::string& path, int flags) {
+        // "UI/a.png" and "./UI/../UI/a.png" are the same file
+        std::error_code error;
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+        std::string key = error ? path : canonical.string();
+        // Wrap mode is texture state, so repeating and clamped copies are separate
+        // entries. Async is only how the entry is filled, not part of its identity.
+        return key + "|" + std::to_string(flags & ~TEXTURE_ASYNC);
+    }
+
+    // Safe to call from worker threads. Shrinks to fit maxWidth x maxHeight,
+    // never enlarges.
+    SDL_Surface* TextureCache::Decode(const std::string& path, int maxWidth, int maxHeight, int& sourceWidth, int& sourceHeight) {
+        SDL_Surface* loaded = IMG_Load(path.c_str());
+        if (!loaded) {
+            std::cerr << "Failed to load texture " << path << ": " << IMG_GetError() << std::endl;
+            return nullptr;
+        }
+        // Normalize palettes and BGR so every upload is RGBA
+        SDL_Surface* surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(loaded);
         if (!surface) {
-            std::cerr << "Failed to load texture: " << IMG_GetError() << std::endl;
-            return { 0, 0, 0 }; // Return an empty texture info on failure
+            std::cerr << "Failed to convert texture " << path << ": " << SDL_GetError() << std::endl;
+            return nullptr;
         }
 
-        GLuint texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
+        sourceWidth = surface->w;
+        sourceHeight = surface->h;
+        int width = std::min(surface->w, std::max(maxWidth, 1));
+        int height = std::min(surface->h, std::max(maxHeight, 1));
+        if (width == surface->w && height == surface->h) {
+            return surface;
+        }
+
+        SDL_Surface* scaled = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+        if (!scaled) {
+            return surface; // Full size is still correct, just larger
+        }
+        resampleRGBA(static_cast<const unsigned char*>(surface->pixels), surface->w, surface->h, surface->pitch,
+            static_cast<unsigned char*>(scaled->pixels), width, height, scaled->pitch);
+        SDL_FreeSurface(surface);
+        return scaled;
+    }
+
+    // Records a holder's display size, returns true when the current texels no
+    // longer serve every holder and the image should be loaded again
+    bool TextureCache::RequestSize(Entry& entry, int displayWidth, int displayHeight) {
+        int previousWidth = entry.maxWidth;
+        int previousHeight = entry.maxHeight;
+        bool explicitSize = displayWidth > 0 && displayHeight > 0;
+        entry.maxWidth = std::max(entry.maxWidth, explicitSize ? displayWidth : INT_MAX);
+        entry.maxHeight = std::max(entry.maxHeight, explicitSize ? displayHeight : INT_MAX);
+        if (explicitSize) {
+            entry.minWidth = std::min(entry.minWidth, displayWidth);
+            entry.minHeight = std::min(entry.minHeight, displayHeight);
+        }
+        if (previousWidth == 0) {
+            return false; // First holder, the initial load uses these values
+        }
 
-        GLenum format;
-        if (surface->format->BytesPerPixel == 4) {
-            format = surface->format->Rmask == 0x000000ff ? GL_RGBA : GL_BGRA;
+        Texture& texture = *entry.texture;
+        if (!texture.resident) {
+            // Loading at the old size, restart it if that is now too small
+            return entry.maxWidth > previousWidth || entry.maxHeight > previousHeight;
+        }
+        bool tooSmall = (texture.width < std::min(entry.maxWidth, entry.sourceWidth)) ||
+            (texture.height < std::min(entry.maxHeight, entry.sourceHeight));
+        bool needsMipmaps = !entry.mipmapped && WantsMipmaps(entry, texture.width, texture.height);
+        if (!tooSmall && needsMipmaps && entry.page < 0) {
+            // Same texels, just add the chain in place
+            bindTexture(texture.id);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            residentBytes += texture.bytes / 3;
+            texture.bytes += texture.bytes / 3;
+            entry.mipmapped = true;
+            return false;
+        }
+        return tooSmall || needsMipmaps; // Atlased images can't carry mipmaps, they move out
+    }
+
+    // Minification past about 1.5x aliases badly without a mip chain
+    bool TextureCache::WantsMipmaps(const Entry& entry, int width, int height) {
+        return entry.minWidth != INT_MAX && (entry.minWidth * 3 < width * 2 || entry.minHeight * 3 < height * 2);
+    }
+
+    // Starts a decode at the entry's current size limits. Async loads decode on
+    // the worker pool and finish in Update(); the rest complete before returning.
+    bool TextureCache::Load(const std::string& key, Entry& entry, bool async) {
+        uint64_t serial = nextSerial++;
+        entry.serial = serial;
+        std::string path = entry.path;
+        int maxWidth = entry.maxWidth;
+        int maxHeight = entry.maxHeight;
+
+        if (!async) {
+            PendingUpload pending;
+            pending.key = key;
+            pending.serial = serial;
+            pending.surface = Decode(path, maxWidth, maxHeight, pending.sourceWidth, pending.sourceHeight);
+            if (!pending.surface) {
+                return false;
+            }
+            size_t unlimited = SIZE_MAX;
+            UploadStep(pending, entry, unlimited);
+            return true;
+        }
+
+        if (!wakeEvent) {
+            wakeEvent = SDL_RegisterEvents(1);
+        }
+        auto decode = [path, key, serial, maxWidth, maxHeight]() {
+            PendingUpload pending;
+            pending.key = key;
+            pending.serial = serial;
+            pending.surface = Decode(path, maxWidth, maxHeight, pending.sourceWidth, pending.sourceHeight);
+            {
+                std::lock_guard<std::mutex> lock(decodedMutex);
+                decoded.push_back(pending);
+            }
+            // Wake a loop sleeping in SDL_WaitEvent so the upload happens promptly
+            if (wakeEvent != static_cast<Uint32>(-1)) {
+                SDL_Event event = {};
+                event.type = wakeEvent;
+                SDL_PushEvent(&event);
+            }
+        };
+        if (workerPool().size() > 0) {
+            workerPool().submit(decode);
         }
         else {
-            format = surface->format->Rmask == 0x000000ff ? GL_RGB : GL_BGR;
+            decode(); // Single core, nothing to hand it to
         }
+        return true;
+    }
 
-        glTexImage2D(GL_TEXTURE_2D, 0, format == GL_RGBA ? GL_RGBA : GL_RGB, surface->w, surface->h, 0, format, GL_UNSIGNED_BYTE, surface->pixels);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glBindTexture(GL_TEXTURE_2D, 0);
+    // Uploads as many rows as the budget allows. Returns true once the staging
+    // texture is complete and has replaced the entry's storage.
+    bool TextureCache::UploadStep(PendingUpload& pending, Entry& entry, size_t& budget) {
+        SDL_Surface* surface = pending.surface;
+        Texture& staging = pending.staging;
+
+        if (!pending.started) {
+            pending.started = true;
+            staging.width = surface->w;
+            staging.height = surface->h;
+            entry.sourceWidth = pending.sourceWidth;
+            entry.sourceHeight = pending.sourceHeight;
+            pending.mipmaps = WantsMipmaps(entry, surface->w, surface->h);
+            if (!pending.mipmaps && !(entry.flags & (TEXTURE_REPEAT | TEXTURE_NO_ATLAS))) {
+                pending.page = UploadToAtlas(staging, surface);
+            }
+            if (pending.page >= 0) {
+                // Atlas candidates are small, they go up in one piece
+                budget -= std::min(budget, staging.bytes);
+                pending.row = surface->h;
+            }
+            else {
+                AllocateStandalone(staging, entry.flags, pending.mipmaps);
+            }
+        }
+
+        if (pending.row < surface->h) {
+            // At least one row per call so huge images still make progress
+            size_t rowBytes = static_cast<size_t>(surface->w) * 4;
+            int rows = static_cast<int>(std::min<size_t>(std::max<size_t>(budget / rowBytes, 1), static_cast<size_t>(surface->h - pending.row)));
+            const unsigned char* pixels = static_cast<const unsigned char*>(surface->pixels) + static_cast<size_t>(pending.row) * surface->pitch;
+            UploadRegion(staging.id, 0, pending.row, surface->w, rows, pixels, surface->pitch);
+            pending.row += rows;
+            budget -= std::min(budget, rows * rowBytes);
+        }
+
+        if (pending.row < surface->h) {
+            return false;
+        }
+
+        if (pending.mipmaps) {
+            bindTexture(staging.id);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+
+        // Swap the finished texels in under the same Texture pointer
+        Texture& texture = *entry.texture;
+        FreeStorage(texture, entry.page);
+        texture.id = staging.id;
+        texture.width = staging.width;
+        texture.height = staging.height;
+        texture.uv = staging.uv;
+        texture.bytes = staging.bytes;
+        texture.resident = true;
+        entry.page = pending.page;
+        entry.mipmapped = pending.mipmaps;
 
-        TextureInfo textureInfo = { texture, surface->w, surface->h };
         SDL_FreeSurface(surface);
-        std::cout << "Texture loaded successfully from " << path << std::endl;
-        return textureInfo;
+        pending.surface = nullptr;
+        return true;
+    }
+
+    // Stages texels through a pixel buffer object so the driver can copy them
+    // to the texture without stalling on client memory
+    void TextureCache::UploadRegion(GLuint texture, int x, int y, int w, int h, const void* pixels, int pitch) {
+        if (mirrorSoftTextures) {
+            updateSoftTexture(texture, x, y, w, h, static_cast<const unsigned char*>(pixels), pitch);
+        }
+        size_t rowBytes = static_cast<size_t>(w) * 4;
+        size_t size = rowBytes * h;
+        if (!uploadBuffer) {
+            glGenBuffers(1, &uploadBuffer);
+        }
+
+        bindTexture(texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffer);
+        // Orphan the previous contents so mapping never waits on an upload still in flight
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (staging) {
+            const unsigned char* src = static_cast<const unsigned char*>(pixels);
+            unsigned char* dst = static_cast<unsigned char*>(staging);
+            for (int row = 0; row < h; row++) {
+                std::memcpy(dst + row * rowBytes, src + static_cast<size_t>(row) * pitch, rowBytes);
+            }
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        else {
+            // Mapping failed, upload straight from client memory
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch / 4);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        }
+    }
+
+    // Storage only, texels follow through UploadRegion()
+    void TextureCache::AllocateStandalone(Texture& texture, int flags, bool mipmaps) {
+        GLint wrap = (flags & TEXTURE_REPEAT) ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+        glGenTextures(1, &texture.id);
+        bindTexture(texture.id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, texture.width, texture.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        if (mirrorSoftTextures) {
+            setSoftTexture(texture.id, texture.width, texture.height, 4, nullptr, (flags & TEXTURE_REPEAT) != 0);
+        }
+
+        texture.bytes = static_cast<size_t>(texture.width) * texture.height * 4;
+        if (mipmaps) {
+            texture.bytes += texture.bytes / 3; // The rest of the chain adds a third
+        }
+        residentBytes += texture.bytes;
+    }
+
+    // Copies the image into the first page with room, returns the page or -1
+    // when it should get its own texture instead
+    int TextureCache::UploadToAtlas(Texture& texture, SDL_Surface* surface) {
+        int w = surface->w;
+        int h = surface->h;
+        if (w <= 0 || h <= 0 || w > atlasThreshold || h > atlasThreshold || w + 2 > atlasPageSize || h + 2 > atlasPageSize) {
+            return -1;
+        }
+
+        // A one texel border copied from the edge keeps linear filtering from
+        // picking up the neighbouring image
+        int paddedW = w + 2;
+        int paddedH = h + 2;
+        int x = 0, y = 0;
+        int page = -1;
+        for (size_t i = 0; i < atlasPages.size() && page < 0; i++) {
+            if (atlasPages[i].texture && atlasPages[i].packer.pack(paddedW, paddedH, x, y)) {
+                page = static_cast<int>(i);
+            }
+        }
+        if (page < 0) {
+            // Reuse a slot freed by Release() before growing the list
+            auto freeSlot = std::find_if(atlasPages.begin(), atlasPages.end(), [](const AtlasPage& p) {
+                return p.texture == 0;
+            });
+            if (freeSlot == atlasPages.end()) {
+                freeSlot = atlasPages.insert(atlasPages.end(), AtlasPage());
+            }
+            page = static_cast<int>(freeSlot - atlasPages.begin());
+
+            AtlasPage& fresh = atlasPages[page];
+            fresh.packer = ShelfPacker(atlasPageSize, atlasPageSize, 0);
+            glGenTextures(1, &fresh.texture);
+            bindTexture(fresh.texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlasPageSize, atlasPageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            residentBytes += static_cast<size_t>(atlasPageSize) * atlasPageSize * 4;
+            if (mirrorSoftTextures) {
+                setSoftTexture(fresh.texture, atlasPageSize, atlasPageSize, 4);
+            }
+            fresh.packer.pack(paddedW, paddedH, x, y);
+        }
+
+        std::vector<uint32_t> texels(static_cast<size_t>(paddedW) * paddedH);
+        const unsigned char* pixels = static_cast<const unsigned char*>(surface->pixels);
+        for (int row = 0; row < paddedH; row++) {
+            const uint32_t* src = reinterpret_cast<const uint32_t*>(pixels + std::clamp(row - 1, 0, h - 1) * surface->pitch);
+            uint32_t* dst = &texels[static_cast<size_t>(row) * paddedW];
+            dst[0] = src[0];
+            std::memcpy(dst + 1, src, static_cast<size_t>(w) * 4);
+            dst[paddedW - 1] = src[w - 1];
+        }
+
+        AtlasPage& target = atlasPages[page];
+        UploadRegion(target.texture, x, y, paddedW, paddedH, texels.data(), paddedW * 4);
+        target.users++;
+
+        // Sample the inner rect only, row 0 of the image sits at the top like a standalone texture
+        float size = static_cast<float>(atlasPageSize);
+        texture.id = target.texture;
+        texture.uv = glm::vec4((x + 1) / size, (y + 1) / size, (x + 1 + w) / size, (y + 1 + h) / size);
+        texture.bytes = static_cast<size_t>(paddedW) * paddedH * 4;
+        return page;
+    }
+
+    // Gives back a texture's GL storage, its atlas rect or its own texture
+    void TextureCache::FreeStorage(Texture& texture, int page) {
+        if (page >= 0) {
+            AtlasPage& atlasPage = atlasPages[page];
+            if (--atlasPage.users == 0) {
+                removeSoftTexture(atlasPage.texture);
+                forgetTexture(atlasPage.texture);
+                glDeleteTextures(1, &atlasPage.texture);
+                atlasPage.texture = 0;
+                residentBytes -= static_cast<size_t>(atlasPageSize) * atlasPageSize * 4;
+            }
+        }
+        else if (texture.id) {
+            removeSoftTexture(texture.id);
+            forgetTexture(texture.id);
+            glDeleteTextures(1, &texture.id);
+            residentBytes -= texture.bytes;
+        }
+        texture.id = 0;
+        texture.bytes = 0;
+    }
+
+    // Returns nullptr when the image can't be loaded. Every non-null result needs a Release().
+    // With TEXTURE_ASYNC the result is never null, and stays non-resident if decoding fails.
+    // Without it the result is always resident, even when an async load of the same image is in flight.
+    Texture* TextureCache::Acquire(const std::string& path, int flags, int displayWidth, int displayHeight) {
+        if (path.empty()) {
+            return nullptr;
+        }
+        bool async = (flags & TEXTURE_ASYNC) != 0;
+        std::string key = Key(path, flags);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            Entry& entry = it->second;
+            bool reload = RequestSize(entry, displayWidth, displayHeight);
+            if (!async && !entry.texture->resident) {
+                // Still decoding, or the async decode failed. Load it here and
+                // supersede the one in flight, its result is dropped by serial.
+                if (!Load(key, entry, false)) {
+                    return nullptr;
+                }
+            }
+            else if (reload) {
+                Load(key, entry, async);
+            }
+            entry.refCount++;
+            return entry.texture.get();
+        }
+
+        Entry& entry = entries[key];
+        entry.texture = std::make_unique<Texture>();
+        entry.path = path;
+        entry.refCount = 1;
+        entry.flags = flags;
+        RequestSize(entry, displayWidth, displayHeight);
+        if (!Load(key, entry, async)) {
+            entries.erase(key);
+            return nullptr;
+        }
+        keys[entry.texture.get()] = key;
+        return entry.texture.get();
+    }
+
+    bool TextureCache::HasPendingUploads() {
+        if (!uploads.empty()) {
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        return !decoded.empty();
+    }
+
+    bool TextureCache::Update() {
+        std::vector<PendingUpload> finished;
+        {
+            std::lock_guard<std::mutex> lock(decodedMutex);
+            finished.swap(decoded);
+        }
+        for (auto& pending : finished) {
+            if (pending.surface) {
+                uploads.push_back(pending);
+            }
+        }
+
+        bool becameResident = false;
+        size_t budget = uploadBudget;
+        while (!uploads.empty() && budget > 0) {
+            PendingUpload& pending = uploads.front();
+            auto it = entries.find(pending.key);
+            if (it == entries.end() || it->second.serial != pending.serial) {
+                // Released, or superseded by a reload at another size
+                FreeStorage(pending.staging, pending.page);
+                SDL_FreeSurface(pending.surface);
+                uploads.pop_front();
+                continue;
+            }
+            if (UploadStep(pending, it->second, budget)) {
+                becameResident = true;
+                uploads.pop_front();
+            }
+        }
+        return becameResident;
+    }
+
+    void TextureCache::Release(Texture* texture) {
+        if (!texture) {
+            return;
+        }
+        auto keyIt = keys.find(texture);
+        if (keyIt == keys.end()) {
+            return;
+        }
+        auto it = entries.find(keyIt->second);
+        if (--it->second.refCount > 0) {
+            return;
+        }
+
+        // Loads still in flight see the entry gone and clean up after themselves
+        FreeStorage(*texture, it->second.page);
+        keys.erase(keyIt);
+        entries.erase(it);
+    }
+
+    // Define a struct to hold texture information
+    struct TextureInfo {
+        GLuint id;
+        int width;
+        int height;
+    };
+
+    // Loads through the cache. The reference is never released, so this suits
+    // textures that live as long as the program; use TextureCache for the rest.
+    // Callers sample the whole id, so it is never packed into an atlas.
+    TextureInfo loadTexture(const char* path) {
+        Texture* texture = TextureCache::Acquire(path, TEXTURE_NO_ATLAS);
+        if (!texture) {
+            return { 0, 0, 0 }; // Return an empty texture info on failure
+        }
+        return { texture->id, texture->width, texture->height };
     }
 
    
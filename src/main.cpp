@@ -18,46 +18,6 @@ void setWidgetOptions(int widgetID, Atlas::WidgetOptions options)
     widgetOptions[widgetID] = options;
 }
 
-GLuint loadTexture(const char* path) {
-    SDL_Surface* surface = IMG_Load(path); // Use IMG_Load instead of SDL_LoadBMP
-    if (!surface) {
-        std::cerr << "Failed to load texture: " << IMG_GetError() << std::endl; // Use IMG_GetError for error reporting
-        return 0;
-    }
-
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-
-    // Determine the format of the image
-    GLenum format;
-    if (surface->format->BytesPerPixel == 4) {
-        format = surface->format->Rmask == 0x000000ff ? GL_RGBA : GL_BGRA;
-    }
-    else {
-        format = surface->format->Rmask == 0x000000ff ? GL_RGB : GL_BGR;
-    }
-
-    glTexImage2D(GL_TEXTURE_2D, 0, format == GL_RGBA ? GL_RGBA : GL_RGB, surface->w, surface->h, 0, format, GL_UNSIGNED_BYTE, surface->pixels);
-
-    // Generate mipmaps
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    // Set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // Use mipmaps for minification
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // Set texture wrapping parameters (optional, but good to check)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // Changed to GL_CLAMP_TO_EDGE for better edge handling
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    SDL_FreeSurface(surface);
-    std::cout << "Texture loaded successfully from " << path << std::endl;
-    return texture;
-}
-
 int main(int argc, char* argv[])
 {
     Atlas::Setup("Atlas UI Example", Atlas::SCREEN_WIDTH, Atlas::SCREEN_HEIGHT);
@@ -104,43 +64,10 @@ int main(int argc, char* argv[])
     Atlas::Text("Hello World", 1.0f, 100, 100);
     Atlas::endWidget();
  
-    bool quit = false;
-    SDL_Event event;
-    
-    while (!quit) {
-        while (SDL_PollEvent(&event) != 0) {
-            if (event.type == SDL_QUIT) {
-                quit = true;
-            }
-
-            Atlas::handleEvents(&event);
-            if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_RESIZED) {
-                int newWidth = event.window.data1;
-                int newHeight = event.window.data2;
-
-                // Assuming you have access to an instance of the class or namespace where setProjectionMatrix is defined
-                Atlas::setProjectionMatrix(newWidth, newHeight);
-
-                glViewport(0, 0, newWidth, newHeight);
-            }
-            
-        }
-    
-     
-        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        if (isshown)
-        {
-            Atlas::renderUI();
-            }
-    
-
-
-        Atlas::renderUI();
-        
-        SDL_GL_SwapWindow(Atlas::g_window);
-    }
+    // Sleeps while the UI is idle, handles resizing and only presents when something changed
+    Atlas::RunOptions options;
+    options.maxFPS = 60;
+    Atlas::run(options);
 
     Atlas::Shutdown();
     return 0;